@@ -0,0 +1,361 @@
+// Benchmark.cpp
+//
+// Measures the code paths that earlier versions made slow against copies of
+// those earlier versions. Built with -DBUILD_BENCHMARKS=ON:
+//
+//   codebase_processor_benchmark matcher [--paths <n>] [--legacy-paths <n>]
+//   codebase_processor_benchmark export [--size-gb <n>] [--file-kb <n>] [--tree <dir>]
+
+#include "FileExtensionConfig.h"
+#include "FileProcessingWorker.h"
+#include "FilterEngine.h"
+#include "GitIgnoreMatcher.h"
+#include "ParallelTreeWalker.h"
+#include "ScanSnapshot.h"
+#include <QBitArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <set>
+
+namespace {
+
+void report(const char* name, qint64 count, const char* unit, qint64 nanoseconds) {
+    const double seconds = nanoseconds / 1e9;
+    std::printf("%-10s %12lld %s in %9.3f s  %14.0f %s/s\n", name, static_cast<long long>(count),
+                unit, seconds, seconds > 0 ? count / seconds : 0.0, unit);
+}
+
+// --- matcher ---------------------------------------------------------------
+
+// FileSystemModelWithGitIgnore::isPathIgnored as it was before
+// GitIgnoreMatcher: every pattern compiled anew for every path
+class LegacyIgnoreMatcher {
+public:
+    LegacyIgnoreMatcher(const QStringList& defaultPatterns, const QStringList& gitIgnoreLines) {
+        defaultIgnorePatterns = defaultPatterns.toVector();
+        for (QString line : gitIgnoreLines) {
+            line = line.trimmed();
+            if (!line.isEmpty() && !line.startsWith('#')) {
+                if (line.endsWith("/")) {
+                    line += "*";
+                }
+                gitIgnorePatterns.append(line);
+            }
+        }
+    }
+
+    bool isPathIgnored(const QString& relativePath) const {
+        for (const QString& pattern : defaultIgnorePatterns) {
+            QRegularExpression rx(QRegularExpression::wildcardToRegularExpression(pattern),
+                                QRegularExpression::CaseInsensitiveOption);
+            if (rx.match(relativePath).hasMatch()) {
+                return true;
+            }
+        }
+        for (const QString& pattern : gitIgnorePatterns) {
+            QRegularExpression rx(QRegularExpression::wildcardToRegularExpression(pattern),
+                                QRegularExpression::CaseInsensitiveOption);
+            if (rx.match(relativePath).hasMatch()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    QVector<QString> defaultIgnorePatterns;
+    QVector<QString> gitIgnorePatterns;
+};
+
+// About 150 lines, in the proportions real .gitignore files have them:
+// mostly names, extensions and anchored paths, some true globs
+QStringList syntheticGitIgnore() {
+    QStringList lines = {"# generated", "*.o", "*.obj", "*.pyc", "*.log", "*.tmp", "build/",
+                         "dist/", "out/", ".DS_Store", "Thumbs.db", "/TODO", "docs/_build/",
+                         "**/cache/**", "*.sw[op]", "!keep.log"};
+    for (int i = 0; lines.size() < 150; ++i) {
+        switch (i % 5) {
+        case 0: lines << QString("generated%1").arg(i); break;
+        case 1: lines << QString("*.ext%1").arg(i); break;
+        case 2: lines << QString("/vendor%1/lib").arg(i); break;
+        case 3: lines << QString("tmp%1-*.txt").arg(i); break;
+        case 4: lines << QString("src/**/gen%1_*.cpp").arg(i); break;
+        }
+    }
+    return lines;
+}
+
+// Relative paths up to five directories deep, some of them ignored
+QStringList syntheticPaths(int count) {
+    static const char* const directories[] = {"src", "include", "lib", "test", "docs", "build",
+                                              "tools", "core", "ui", "net", "cache", "vendor12"};
+    static const char* const names[] = {"main", "util", "parser", "gen4_table", "tmp8-run",
+                                        "widget", "keep", "model", "view", "generated0"};
+    static const char* const extensions[] = {"cpp", "h", "py", "log", "o", "txt", "md",
+                                             "json", "ext6", "swp"};
+    std::mt19937 random(42);
+    QStringList paths;
+    paths.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QString path;
+        for (int depth = static_cast<int>(random() % 6); depth > 0; --depth) {
+            path += QLatin1String(directories[random() % std::size(directories)]) + '/';
+        }
+        path += QLatin1String(names[random() % std::size(names)]) + '.' +
+                QLatin1String(extensions[random() % std::size(extensions)]);
+        paths << path;
+    }
+    return paths;
+}
+
+// Like FilterEngine, the compiled matcher is asked about every directory on
+// the way down, so that is part of what it costs here
+bool compiledIgnores(const GitIgnoreMatcher& matcher, QStringView relativePath) {
+    for (qsizetype slash = relativePath.indexOf('/'); slash >= 0;
+         slash = relativePath.indexOf('/', slash + 1)) {
+        if (matcher.match(relativePath.left(slash), true) == GitIgnoreMatcher::Result::Ignored) {
+            return true;
+        }
+    }
+    return matcher.match(relativePath, false) == GitIgnoreMatcher::Result::Ignored;
+}
+
+int benchmarkMatcher(int pathCount, int legacyPathCount) {
+    const QStringList defaults = FileExtensionConfig::getInstance().getExcludedDirectories();
+    const QStringList gitIgnore = syntheticGitIgnore();
+    const QStringList paths = syntheticPaths(pathCount);
+    std::printf("%d default patterns, %lld .gitignore lines, %d paths\n",
+                static_cast<int>(defaults.size()), static_cast<long long>(gitIgnore.size()), pathCount);
+
+    // Each is timed with its setup, which the old code repeated per call
+    QElapsedTimer timer;
+    timer.start();
+    GitIgnoreMatcher compiled(defaults);
+    compiled.addPatterns(gitIgnore);
+    int compiledIgnored = 0;
+    for (const QString& path : paths) {
+        compiledIgnored += compiledIgnores(compiled, path);
+    }
+    const qint64 compiledTime = timer.nsecsElapsed();
+
+    // Too slow to run over every path; its rate is what counts
+    const int legacyCount = qMin(legacyPathCount, pathCount);
+    timer.restart();
+    const LegacyIgnoreMatcher legacy(defaults, gitIgnore);
+    int legacyIgnored = 0;
+    for (int i = 0; i < legacyCount; ++i) {
+        legacyIgnored += legacy.isPathIgnored(paths[i]);
+    }
+    const qint64 legacyTime = timer.nsecsElapsed();
+
+    report("legacy", legacyCount, "paths", legacyTime);
+    report("compiled", pathCount, "paths", compiledTime);
+    std::printf("ignored: legacy %d of %d, compiled %d of %d (the legacy matcher misses\n"
+                "nested matches, so the counts differ)\n",
+                legacyIgnored, legacyCount, compiledIgnored, pathCount);
+    if (legacyTime > 0 && compiledTime > 0) {
+        std::printf("speedup: %.1fx\n", (double(pathCount) / compiledTime) / (double(legacyCount) / legacyTime));
+    }
+    return 0;
+}
+
+// --- export ----------------------------------------------------------------
+
+constexpr int kFilesPerDirectory = 256;
+
+// Text files of fileBytes each, every one different so that deduplication
+// has nothing to skip; a tree already at root is reused
+qint64 generateTree(const QString& root, qint64 totalBytes, qint64 fileBytes) {
+    const qint64 fileCount = qMax<qint64>((totalBytes + fileBytes - 1) / fileBytes, 1);
+    const QString marker = root + "/.benchmark-tree";
+    const QByteArray description = QByteArray::number(fileCount) + ' ' + QByteArray::number(fileBytes);
+    QFile markerFile(marker);
+    if (markerFile.open(QIODevice::ReadOnly) && markerFile.readAll() == description) {
+        std::printf("Reusing the tree in %s\n", qPrintable(root));
+        return fileCount * fileBytes;
+    }
+    markerFile.close();
+
+    std::printf("Writing %lld files of %lld bytes to %s\n", static_cast<long long>(fileCount),
+                static_cast<long long>(fileBytes), qPrintable(root));
+    QByteArray content;
+    content.reserve(fileBytes + 128);
+    for (qint64 file = 0; file < fileCount; ++file) {
+        const QString directory = QString("%1/dir%2").arg(root).arg(file / kFilesPerDirectory, 5, 10, QChar('0'));
+        if (file % kFilesPerDirectory == 0 && !QDir().mkpath(directory)) {
+            std::fprintf(stderr, "Could not create %s\n", qPrintable(directory));
+            return -1;
+        }
+        content.clear();
+        for (qint64 line = 0; content.size() < fileBytes; ++line) {
+            content += "    value_" + QByteArray::number(file) + '_' + QByteArray::number(line) +
+                       " = compute(value_" + QByteArray::number(line) + ", \"synthetic line\");\n";
+        }
+        content.truncate(fileBytes - 1);
+        content += '\n';
+        QFile output(QString("%1/file%2.txt").arg(directory).arg(file, 7, 10, QChar('0')));
+        if (!output.open(QIODevice::WriteOnly) || output.write(content) != content.size()) {
+            std::fprintf(stderr, "Could not write %s\n", qPrintable(output.fileName()));
+            return -1;
+        }
+    }
+    if (markerFile.open(QIODevice::WriteOnly)) {
+        markerFile.write(description);
+    }
+    return fileCount * fileBytes;
+}
+
+// FileProcessingWorker::process() as it was before the export pipeline,
+// followed by what MainWindow did to save its result: every file read
+// whole, widened to a QString, appended, and narrowed back to UTF-8
+qint64 legacyExport(const QString& rootPath, const std::set<QString>& processableFiles,
+                    const QString& savePath) {
+    QString result;
+    QDir baseDir(rootPath);
+    qint64 totalProcessedSize = 0;
+    for (const QString& filePath : processableFiles) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::fprintf(stderr, "Could not open file: %s\n", qPrintable(filePath));
+            return -1;
+        }
+        QByteArray content = file.readAll();
+        QString relativePath = baseDir.relativeFilePath(filePath);
+        result += "=== " + relativePath + " ===\n";
+        result += QString::fromUtf8(content);
+        result += "\n\n";
+        totalProcessedSize += content.size();
+        QThread::msleep(1);
+    }
+
+    QFile file(savePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return -1;
+    }
+    file.write("\xEF\xBB\xBF");
+    file.write(result.toUtf8());
+    return totalProcessedSize;
+}
+
+int benchmarkExport(qint64 totalBytes, qint64 fileBytes, const QString& treePath) {
+    std::unique_ptr<QTemporaryDir> temporaryTree;
+    QString rootPath = treePath;
+    if (rootPath.isEmpty()) {
+        temporaryTree = std::make_unique<QTemporaryDir>();
+        rootPath = temporaryTree->path();
+    }
+    rootPath = QDir::cleanPath(QFileInfo(rootPath).absoluteFilePath());
+    const qint64 treeBytes = generateTree(rootPath, totalBytes, fileBytes);
+    if (treeBytes < 0) {
+        return 1;
+    }
+    QTemporaryDir outputDirectory;
+    if (!outputDirectory.isValid()) {
+        std::fprintf(stderr, "Could not create an output directory\n");
+        return 1;
+    }
+
+    // The scan both of them start from, as the window has it
+    QElapsedTimer timer;
+    timer.start();
+    ParallelTreeWalker walker(QSharedPointer<const FilterEngine>::create(rootPath));
+    walker.walk();
+    const QSharedPointer<ScanSnapshot> snapshot = walker.snapshot();
+    if (!snapshot) {
+        std::fprintf(stderr, "Could not scan %s\n", qPrintable(rootPath));
+        return 1;
+    }
+    QBitArray selectedFiles(snapshot->nodeCount());
+    std::set<QString> processableFiles;
+    qint64 inputBytes = 0;
+    for (int node = 1; node < snapshot->nodeCount(); ++node) {
+        if (!snapshot->isDirectory(node) && snapshot->isAccepted(node)) {
+            selectedFiles.setBit(node);
+            processableFiles.insert(rootPath + '/' + snapshot->relativePath(node));
+            inputBytes += snapshot->record(node).size;
+        }
+    }
+    report("scan", static_cast<qint64>(processableFiles.size()), "files", timer.nsecsElapsed());
+
+    // The tree was just written or read, so both start from the page cache
+    // as far as it holds the tree; the current export goes first
+    const QString currentOutput = outputDirectory.filePath("current.txt");
+    timer.restart();
+    FileProcessingWorker worker(snapshot, selectedFiles);
+    worker.setOutputPath(currentOutput);
+    bool exported = false;
+    QObject::connect(&worker, &FileProcessingWorker::finished, [&exported]() { exported = true; });
+    QObject::connect(&worker, &FileProcessingWorker::error, [](const QString& message) {
+        std::fprintf(stderr, "%s\n", qPrintable(message));
+    });
+    worker.process();
+    const qint64 currentTime = timer.nsecsElapsed();
+    if (!exported) {
+        return 1;
+    }
+    const qint64 currentOutputBytes = QFileInfo(currentOutput).size();
+    QFile::remove(currentOutput);
+
+    // Holds the whole export in memory, three times over at its peak
+    const QString legacyOutput = outputDirectory.filePath("legacy.txt");
+    timer.restart();
+    if (legacyExport(rootPath, processableFiles, legacyOutput) < 0) {
+        return 1;
+    }
+    const qint64 legacyTime = timer.nsecsElapsed();
+    const qint64 legacyOutputBytes = QFileInfo(legacyOutput).size();
+    QFile::remove(legacyOutput);
+
+    report("legacy", inputBytes, "bytes", legacyTime);
+    report("current", inputBytes, "bytes", currentTime);
+    std::printf("output: legacy %lld bytes, current %lld bytes\n",
+                static_cast<long long>(legacyOutputBytes), static_cast<long long>(currentOutputBytes));
+    if (legacyTime > 0 && currentTime > 0) {
+        std::printf("speedup: %.1fx\n", double(legacyTime) / currentTime);
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the matcher or the export against the implementation it replaced.");
+    parser.addHelpOption();
+    const QCommandLineOption pathsOption("paths", "Paths the compiled matcher checks.", "n", "200000");
+    const QCommandLineOption legacyPathsOption("legacy-paths", "Paths the legacy matcher checks.", "n", "2000");
+    const QCommandLineOption sizeOption("size-gb", "Size of the exported tree.", "n", "2");
+    const QCommandLineOption fileSizeOption("file-kb", "Size of each file in the tree.", "n", "64");
+    const QCommandLineOption treeOption("tree", "Keep the tree in <dir> and reuse it, instead of a temporary one.", "dir");
+    parser.addOptions({pathsOption, legacyPathsOption, sizeOption, fileSizeOption, treeOption});
+    parser.addPositionalArgument("benchmark", "matcher or export");
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    const QString benchmark = arguments.isEmpty() ? QString("matcher") : arguments.first();
+    if (benchmark == "matcher") {
+        return benchmarkMatcher(qMax(parser.value(pathsOption).toInt(), 1),
+                                qMax(parser.value(legacyPathsOption).toInt(), 1));
+    }
+    if (benchmark == "export") {
+        const qint64 totalBytes = static_cast<qint64>(qMax(parser.value(sizeOption).toDouble(), 0.001) * (1 << 30));
+        const qint64 fileBytes = qMax(parser.value(fileSizeOption).toLongLong(), qint64(1)) * 1024;
+        return benchmarkExport(totalBytes, fileBytes, parser.value(treeOption));
+    }
+    std::fprintf(stderr, "Unknown benchmark: %s\n", qPrintable(benchmark));
+    return 2;
+}
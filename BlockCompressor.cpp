@@ -0,0 +1,182 @@
+#include "BlockCompressor.h"
+#include "WorkStealingThreadPool.h"
+#include <QMutexLocker>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Large enough that per-block headers and lost history cost little, small
+// enough to keep every core busy on a few MB of output
+constexpr qsizetype kBlockSize = 1024 * 1024;
+constexpr size_t kBlocksPerThread = 2;
+
+// The command-line tools' defaults
+constexpr int kGzipLevel = 6;
+constexpr int kZstdLevel = 3;
+
+} // namespace
+
+BlockCompressor::Format BlockCompressor::formatForPath(const QString& path) {
+#ifdef HAVE_ZLIB
+    if (path.endsWith(".gz", Qt::CaseInsensitive)) {
+        return Format::Gzip;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (path.endsWith(".zst", Qt::CaseInsensitive)) {
+        return Format::Zstd;
+    }
+#endif
+    Q_UNUSED(path);
+    return Format::None;
+}
+
+QStringList BlockCompressor::fileFilters() {
+    QStringList filters;
+#ifdef HAVE_ZLIB
+    filters << "Gzip-Compressed Text (*.txt.gz)";
+#endif
+#ifdef HAVE_ZSTD
+    filters << "Zstandard-Compressed Text (*.txt.zst)";
+#endif
+    return filters;
+}
+
+BlockCompressor::BlockCompressor(Format format, QIODevice* target, QObject* parent)
+    : QIODevice(parent)
+    , m_format(format)
+    , m_target(target)
+    , m_pool(std::make_unique<WorkStealingThreadPool>()) {
+    m_maxBlocksInFlight = static_cast<size_t>(m_pool->threadCount()) * kBlocksPerThread;
+    m_buffer.reserve(kBlockSize);
+}
+
+BlockCompressor::~BlockCompressor() = default;
+
+qint64 BlockCompressor::readData(char* data, qint64 maxSize) {
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+qint64 BlockCompressor::writeData(const char* data, qint64 size) {
+    qint64 written = 0;
+    while (written < size) {
+        const qint64 taken = qMin(size - written, kBlockSize - m_buffer.size());
+        m_buffer.append(data + written, static_cast<qsizetype>(taken));
+        written += taken;
+        if (m_buffer.size() == kBlockSize && !submitBlock()) {
+            return -1;
+        }
+    }
+    return size;
+}
+
+bool BlockCompressor::submitBlock() {
+    auto block = std::make_shared<Block>();
+    block->input = std::move(m_buffer);
+    m_buffer = QByteArray();
+    m_buffer.reserve(kBlockSize);
+    m_submittedAny = true;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_blocks.push_back(block);
+    }
+
+    m_pool->submit([this, block]() {
+        QByteArray output;
+        const bool ok = compress(m_format, block->input, output);
+        QMutexLocker locker(&m_mutex);
+        block->output = std::move(output);
+        block->input = QByteArray();
+        block->ok = ok;
+        block->done = true;
+        m_blockDone.wakeAll();
+    });
+
+    // Writing waits only once the pool is as far ahead as it may get
+    return writeBlocks(m_maxBlocksInFlight);
+}
+
+bool BlockCompressor::writeBlocks(size_t maxPending) {
+    for (;;) {
+        std::shared_ptr<Block> block;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_blocks.empty()) {
+                return true;
+            }
+            block = m_blocks.front();
+            while (!block->done && m_blocks.size() > maxPending) {
+                m_blockDone.wait(&m_mutex);
+            }
+            if (!block->done) {
+                return true;
+            }
+            m_blocks.pop_front();
+        }
+
+        if (!block->ok) {
+            setErrorString("Compression failed");
+            return false;
+        }
+        if (m_target->write(block->output) != block->output.size()) {
+            setErrorString(m_target->errorString());
+            return false;
+        }
+    }
+}
+
+bool BlockCompressor::finish() {
+    // Even empty output is one member or frame, so it still decompresses
+    if ((!m_buffer.isEmpty() || !m_submittedAny) && !submitBlock()) {
+        return false;
+    }
+    return writeBlocks(0);
+}
+
+bool BlockCompressor::compress(Format format, const QByteArray& input, QByteArray& output) {
+    switch (format) {
+#ifdef HAVE_ZLIB
+    case Format::Gzip: {
+        z_stream stream = {};
+        // 15 + 16: the largest window, with a gzip header and trailer
+        if (deflateInit2(&stream, kGzipLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        output.resize(static_cast<qsizetype>(deflateBound(&stream, static_cast<uLong>(input.size()))));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+        stream.avail_in = static_cast<uInt>(input.size());
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = static_cast<uInt>(output.size());
+        const bool ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        output.resize(static_cast<qsizetype>(stream.total_out));
+        deflateEnd(&stream);
+        return ok;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case Format::Zstd: {
+        output.resize(static_cast<qsizetype>(ZSTD_compressBound(static_cast<size_t>(input.size()))));
+        const size_t size = ZSTD_compress(output.data(), static_cast<size_t>(output.size()),
+                                          input.constData(), static_cast<size_t>(input.size()),
+                                          kZstdLevel);
+        if (ZSTD_isError(size)) {
+            return false;
+        }
+        output.resize(static_cast<qsizetype>(size));
+        return true;
+    }
+#endif
+    default:
+        Q_UNUSED(input);
+        Q_UNUSED(output);
+        return false;
+    }
+}
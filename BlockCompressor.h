@@ -0,0 +1,77 @@
+// BlockCompressor.h
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QStringList>
+#include <QWaitCondition>
+#include <deque>
+#include <memory>
+
+class WorkStealingThreadPool;
+
+// Compresses what is written to it into gzip or zstd, on every core.
+//
+// Input is cut into fixed-size blocks, and each block is compressed on its
+// own by a thread pool into a complete gzip member or zstd frame. The
+// results go to the target device in input order. A series of members or
+// frames is a valid gzip or zstd stream, so gzip -d, zcat and zstd -d read
+// the output like any other; blocks not sharing history costs a few
+// percent of ratio at this block size.
+//
+// Which formats exist depends on the libraries found at build time
+// (HAVE_ZLIB, HAVE_ZSTD).
+class BlockCompressor : public QIODevice {
+    Q_OBJECT
+
+public:
+    enum class Format {
+        None,
+        Gzip,
+        Zstd
+    };
+
+    // By suffix (.gz, .zst); None for anything this build can't write
+    static Format formatForPath(const QString& path);
+    // Save dialog filters for the formats this build can write
+    static QStringList fileFilters();
+
+    BlockCompressor(Format format, QIODevice* target, QObject* parent = nullptr);
+    ~BlockCompressor() override;
+
+    bool isSequential() const override { return true; }
+
+    // Compresses what is still buffered and writes out every block; the
+    // target isn't closed
+    bool finish();
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 size) override;
+
+private:
+    struct Block {
+        QByteArray input;
+        QByteArray output;
+        bool done = false;
+        bool ok = false;
+    };
+
+    bool submitBlock();
+    // Writes finished blocks in order, waiting for the oldest while more
+    // than maxPending are left
+    bool writeBlocks(size_t maxPending);
+    static bool compress(Format format, const QByteArray& input, QByteArray& output);
+
+    const Format m_format;
+    QIODevice* m_target;
+    QByteArray m_buffer;
+    bool m_submittedAny = false;
+    QMutex m_mutex;
+    QWaitCondition m_blockDone;
+    std::deque<std::shared_ptr<Block>> m_blocks;    // oldest first
+    size_t m_maxBlocksInFlight;
+    // Declared last: running compressions finish before the rest goes away
+    std::unique_ptr<WorkStealingThreadPool> m_pool;
+};
@@ -0,0 +1,250 @@
+#include "ChangeTracker.h"
+#include "ScanSnapshot.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QDebug>
+#include <utility>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+// Batches are delivered once the tree has been quiet this long...
+constexpr int kQuietPeriodMs = 150;
+// ...but a steady stream of events is not held back longer than this
+constexpr int kMaxBatchDelayMs = 1000;
+
+#ifdef Q_OS_LINUX
+constexpr quint32 kDirectoryEvents = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                     IN_MODIFY | IN_CLOSE_WRITE | IN_ONLYDIR;
+#endif
+}
+
+bool ChangeSet::isEmpty() const {
+    return modifiedFiles.isEmpty() && changedDirectories.isEmpty() &&
+           ignoreDirectories.isEmpty() && !overflowed;
+}
+
+void ChangeSet::unite(const ChangeSet& other) {
+    modifiedFiles.unite(other.modifiedFiles);
+    changedDirectories.unite(other.changedDirectories);
+    ignoreDirectories.unite(other.ignoreDirectories);
+    overflowed = overflowed || other.overflowed;
+}
+
+ChangeTracker::ChangeTracker(const QString& rootPath, QObject* parent)
+    : QObject(parent)
+    , m_rootPath(rootPath) {
+    m_quietTimer.setSingleShot(true);
+    connect(&m_quietTimer, &QTimer::timeout, this, &ChangeTracker::deliver);
+
+#ifdef Q_OS_LINUX
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        qWarning() << "Could not start watching for changes:" << qt_error_string(errno);
+        return;
+    }
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &ChangeTracker::readEvents);
+
+    // .git is never scanned, but its exclude file holds ignore rules
+    m_excludeWatch = ::inotify_add_watch(m_inotifyFd,
+                                         QFile::encodeName(rootPath + "/.git/info").constData(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+#else
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString& path) {
+        m_pending.changedDirectories.insert(relativePath(path));
+        scheduleDelivery();
+    });
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString& path) {
+        QString directory = QFileInfo(path).path();
+        m_pending.ignoreDirectories.insert(directory.endsWith("/.git/info")
+            ? QString()
+            : relativePath(directory));
+        scheduleDelivery();
+    });
+    if (QFileInfo::exists(rootPath + "/.git/info/exclude")) {
+        m_watcher->addPath(rootPath + "/.git/info/exclude");
+    }
+#endif
+}
+
+ChangeTracker::~ChangeTracker() {
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+#endif
+}
+
+QString ChangeTracker::absolutePath(const QString& relativeDir) const {
+    return relativeDir.isEmpty() ? m_rootPath : m_rootPath + '/' + relativeDir;
+}
+
+QString ChangeTracker::relativePath(const QString& absolutePath) const {
+    return absolutePath.size() > m_rootPath.size() ? absolutePath.mid(m_rootPath.size() + 1) : QString();
+}
+
+void ChangeTracker::watchSnapshot(const ScanSnapshot& snapshot) {
+#ifdef Q_OS_LINUX
+    for (auto it = m_directoryByWatch.constBegin(); it != m_directoryByWatch.constEnd(); ++it) {
+        ::inotify_rm_watch(m_inotifyFd, it.key());
+    }
+    m_directoryByWatch.clear();
+    m_watchByDirectory.clear();
+#else
+    const QStringList watched = m_watcher->directories() + m_watcher->files();
+    if (!watched.isEmpty()) {
+        m_watcher->removePaths(watched);
+    }
+    if (QFileInfo::exists(m_rootPath + "/.git/info/exclude")) {
+        m_watcher->addPath(m_rootPath + "/.git/info/exclude");
+    }
+#endif
+
+    for (int node = 0; node < snapshot.nodeCount(); ++node) {
+        if ((snapshot.flags(node) & (ScanSnapshot::Listed | ScanSnapshot::Removed)) == ScanSnapshot::Listed) {
+            watchDirectory(snapshot.relativePath(node));
+        }
+    }
+}
+
+void ChangeTracker::watchDirectory(const QString& relativeDir) {
+    const QString path = absolutePath(relativeDir);
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd < 0 || m_watchLimitReached) {
+        return;
+    }
+    // Watching a path again returns the watch it already has
+    int watch = ::inotify_add_watch(m_inotifyFd, QFile::encodeName(path).constData(), kDirectoryEvents);
+    if (watch < 0) {
+        if (errno == ENOSPC) {
+            m_watchLimitReached = true;
+            qWarning() << "inotify watch limit reached after" << m_watchByDirectory.size()
+                       << "directories; raise fs.inotify.max_user_watches to track the whole tree";
+        }
+        return;
+    }
+    m_watchByDirectory.insert(relativeDir, watch);
+    m_directoryByWatch.insert(watch, relativeDir);
+#else
+    m_watcher->addPath(path);
+    if (QFileInfo::exists(path + "/.gitignore")) {
+        m_watcher->addPath(path + "/.gitignore");
+    }
+#endif
+}
+
+void ChangeTracker::unwatchDirectory(const QString& relativeDir) {
+#ifdef Q_OS_LINUX
+    auto it = m_watchByDirectory.find(relativeDir);
+    if (it == m_watchByDirectory.end()) {
+        return;
+    }
+    // The IN_IGNORED event this produces clears m_directoryByWatch
+    ::inotify_rm_watch(m_inotifyFd, it.value());
+    m_watchByDirectory.erase(it);
+#else
+    const QString path = absolutePath(relativeDir);
+    m_watcher->removePath(path);
+    m_watcher->removePath(path + "/.gitignore");
+#endif
+}
+
+void ChangeTracker::readEvents() {
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t bytes = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < bytes;) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+            handleEvent(event->wd, event->mask, event->len ? QFile::decodeName(event->name) : QString());
+        }
+    }
+    scheduleDelivery();
+#endif
+}
+
+void ChangeTracker::handleEvent(int watch, quint32 mask, const QString& name) {
+#ifdef Q_OS_LINUX
+    if (mask & IN_Q_OVERFLOW) {
+        m_pending.overflowed = true;
+        return;
+    }
+    if (watch == m_excludeWatch) {
+        if (name == "exclude") {
+            m_pending.ignoreDirectories.insert(QString());
+        }
+        return;
+    }
+
+    auto it = m_directoryByWatch.find(watch);
+    if (it == m_directoryByWatch.end()) {
+        return;
+    }
+    const QString relativeDir = it.value();
+    if (mask & IN_IGNORED) {
+        // Removed, either by us or because the directory is gone
+        if (m_watchByDirectory.value(relativeDir, -1) == watch) {
+            m_watchByDirectory.remove(relativeDir);
+        }
+        m_directoryByWatch.erase(it);
+        return;
+    }
+
+    if (name == ".gitignore") {
+        m_pending.ignoreDirectories.insert(relativeDir);
+        return;
+    }
+    // The repository itself is never scanned; other hidden entries are
+    if (name.isEmpty() || name == ".git") {
+        return;
+    }
+
+    if (mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+        m_pending.changedDirectories.insert(relativeDir);
+    } else if (!(mask & IN_ISDIR)) {
+        m_pending.modifiedFiles.insert(relativeDir.isEmpty() ? name : relativeDir + '/' + name);
+    }
+#else
+    Q_UNUSED(watch);
+    Q_UNUSED(mask);
+    Q_UNUSED(name);
+#endif
+}
+
+void ChangeTracker::scheduleDelivery() {
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    if (!m_quietTimer.isActive()) {
+        m_batchAge.start();
+    }
+    // Each event pushes delivery back, up to the maximum delay
+    if (m_batchAge.elapsed() < kMaxBatchDelayMs) {
+        m_quietTimer.start(kQuietPeriodMs);
+    }
+}
+
+void ChangeTracker::deliver() {
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    ChangeSet changes;
+    std::swap(changes, m_pending);
+    qDebug() << "Filesystem changes:" << changes.modifiedFiles.size() << "files modified,"
+             << changes.changedDirectories.size() << "directories changed,"
+             << changes.ignoreDirectories.size() << "ignore files changed"
+             << (changes.overflowed ? "(event queue overflowed)" : "");
+    emit changed(changes);
+}
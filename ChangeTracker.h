@@ -0,0 +1,78 @@
+// ChangeTracker.h
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+class ScanSnapshot;
+
+// What changed below a project root since the last batch. Paths are
+// relative to the root, the root itself is the empty string.
+struct ChangeSet {
+    QSet<QString> modifiedFiles;        // contents were written
+    QSet<QString> changedDirectories;   // entries were created, deleted or renamed
+    QSet<QString> ignoreDirectories;    // a .gitignore (or .git/info/exclude) changed
+    bool overflowed = false;            // events were lost, anything may have changed
+
+    bool isEmpty() const;
+    void unite(const ChangeSet& other);
+};
+
+// Watches the scanned directories of a project root and reports what changed
+// in coalesced batches.
+//
+// On Linux this is a single inotify instance read through a QSocketNotifier,
+// with one watch per directory the filter accepted, so ignored trees such as
+// build output never produce events. Events are collected until the tree has
+// been quiet for a moment, or at most a second, and then delivered as one
+// ChangeSet. When the kernel queue overflows the batch is flagged instead.
+// Elsewhere QFileSystemWatcher is used, which only tells which directory or
+// ignore file changed; where it reports writes to a file as a change of its
+// directory (as on Windows), the walk that follows re-stats the files there.
+class ChangeTracker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ChangeTracker(const QString& rootPath, QObject* parent = nullptr);
+    ~ChangeTracker() override;
+
+    const QString& rootPath() const { return m_rootPath; }
+
+    // Replaces all watches with one per listed directory of the snapshot
+    void watchSnapshot(const ScanSnapshot& snapshot);
+    void watchDirectory(const QString& relativeDir);
+    void unwatchDirectory(const QString& relativeDir);
+
+signals:
+    void changed(const ChangeSet& changes);
+
+private:
+    void readEvents();
+    void handleEvent(int watch, quint32 mask, const QString& name);
+    void scheduleDelivery();
+    void deliver();
+    QString absolutePath(const QString& relativeDir) const;
+    QString relativePath(const QString& absolutePath) const;
+
+    QString m_rootPath;
+    ChangeSet m_pending;
+    QTimer m_quietTimer;
+    QElapsedTimer m_batchAge;
+
+#ifdef Q_OS_LINUX
+    int m_inotifyFd = -1;
+    int m_excludeWatch = -1;
+    bool m_watchLimitReached = false;
+    QSocketNotifier* m_notifier = nullptr;
+    QHash<int, QString> m_directoryByWatch;
+    QHash<QString, int> m_watchByDirectory;
+#else
+    QFileSystemWatcher* m_watcher = nullptr;
+#endif
+};
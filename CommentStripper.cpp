@@ -0,0 +1,494 @@
+#include "CommentStripper.h"
+#include "FileExtensionConfig.h"
+#include <QHash>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+using Syntax = CommentStripper::Syntax;
+
+// Bytes a lexer stops at; everything between them is copied in one go
+constexpr std::array<bool, 256> makeStopTable(Syntax syntax) {
+    std::array<bool, 256> table = {};
+    table['\n'] = true;
+    switch (syntax) {
+    case Syntax::C:
+    case Syntax::Script:
+        table['/'] = table['"'] = table['\''] = table['`'] = table['\\'] = true;
+        break;
+    case Syntax::Css:
+        table['/'] = table['"'] = table['\''] = table['\\'] = true;
+        break;
+    case Syntax::Hash:
+        table['#'] = table['"'] = table['\''] = table['\\'] = true;
+        break;
+    case Syntax::Markup:
+        table['<'] = true;
+        break;
+    case Syntax::None:
+        break;
+    }
+    return table;
+}
+constexpr std::array<bool, 256> kStopC = makeStopTable(Syntax::C);
+constexpr std::array<bool, 256> kStopScript = makeStopTable(Syntax::Script);
+constexpr std::array<bool, 256> kStopCss = makeStopTable(Syntax::Css);
+constexpr std::array<bool, 256> kStopHash = makeStopTable(Syntax::Hash);
+constexpr std::array<bool, 256> kStopMarkup = makeStopTable(Syntax::Markup);
+
+// A character literal is never longer than '\U0001F600'
+constexpr qsizetype kMaxCharLiteral = 12;
+constexpr qsizetype kMaxRawDelimiter = 16;
+
+inline bool isIdentifier(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// First occurrence of needle in [from, to), or to
+const char* find(const char* from, const char* to, const char* needle, size_t length) {
+    while (to - from >= static_cast<qsizetype>(length)) {
+        const char* hit = static_cast<const char*>(std::memchr(from, needle[0], static_cast<size_t>(to - from)));
+        if (!hit || to - hit < static_cast<qsizetype>(length)) {
+            break;
+        }
+        if (std::memcmp(hit, needle, length) == 0) {
+            return hit;
+        }
+        from = hit + 1;
+    }
+    return to;
+}
+
+class Lexer {
+public:
+    Lexer(const QByteArray& content, Syntax syntax)
+        : m_syntax(syntax)
+        , m_begin(content.constData())
+        , m_p(m_begin)
+        , m_end(m_begin + content.size())
+        , m_result(content.size(), Qt::Uninitialized) {
+        // Nothing is ever longer than what it replaces
+        m_out = m_o = m_lineStart = m_protect = m_result.data();
+        switch (syntax) {
+        case Syntax::C: m_stop = kStopC.data(); break;
+        case Syntax::Script: m_stop = kStopScript.data(); break;
+        case Syntax::Css: m_stop = kStopCss.data(); break;
+        case Syntax::Hash: m_stop = kStopHash.data(); break;
+        default: m_stop = kStopMarkup.data(); break;
+        }
+    }
+
+    QByteArray run() {
+        while (m_p < m_end) {
+            const char* run = m_p;
+            while (m_p < m_end && !m_stop[static_cast<unsigned char>(*m_p)]) {
+                ++m_p;
+            }
+            put(run, m_p);
+            if (m_p == m_end) {
+                break;
+            }
+            if (*m_p == '\n') {
+                ++m_p;
+                endLine();
+                continue;
+            }
+            switch (m_syntax) {
+            case Syntax::C:
+            case Syntax::Script:
+            case Syntax::Css:
+                lexC();
+                break;
+            case Syntax::Hash:
+                lexHash();
+                break;
+            default:
+                lexMarkup();
+                break;
+            }
+        }
+
+        // The last line, and no blank one after it
+        trimLine();
+        if (m_lastBlank && m_o == m_lineStart && m_o > m_out) {
+            --m_o;
+        }
+        m_result.truncate(m_o - m_out);
+        return m_result;
+    }
+
+private:
+    // n bytes on from m_p, as far as there are any
+    const char* ahead(qsizetype n) const {
+        return m_p + std::min<qsizetype>(n, m_end - m_p);
+    }
+
+    void put(const char* from, const char* to) {
+        std::memcpy(m_o, from, static_cast<size_t>(to - from));
+        m_o += to - from;
+    }
+
+    // Strings and the like: copied as they are, trailing blanks included
+    void putVerbatim(const char* to) {
+        put(m_p, to);
+        m_p = to;
+        m_protect = m_o;
+    }
+
+    void trimLine() {
+        const char* floor = std::max(m_lineStart, m_protect);
+        while (m_o > floor && isBlank(m_o[-1])) {
+            --m_o;
+        }
+    }
+
+    void endLine() {
+        trimLine();
+        if (m_o == m_lineStart) {
+            // Blank: dropped when a comment was all it had, when the line
+            // before was blank too, or at the start of the file
+            if (m_lineHadComment || m_lastBlank || m_o == m_out) {
+                m_lineHadComment = false;
+                return;
+            }
+            m_lastBlank = true;
+        } else {
+            m_lastBlank = false;
+        }
+        *m_o++ = '\n';
+        m_lineStart = m_o;
+        m_lineHadComment = false;
+    }
+
+    // Skips the comment in [m_p, to); one spanning lines ends the line
+    // it started on
+    void dropComment(const char* to) {
+        to = std::min(to, m_end);
+        const bool spansLines = std::memchr(m_p, '\n', static_cast<size_t>(to - m_p)) != nullptr;
+        m_p = to;
+        m_lineHadComment = true;
+        if (spansLines) {
+            endLine();
+            m_lineHadComment = true;
+        } else if (m_o == m_lineStart || isBlank(m_o[-1])) {
+            // "a /* x */ b" keeps one space, indentation stays as it was
+            while (m_p < m_end && isBlank(*m_p)) {
+                ++m_p;
+            }
+        } else if (m_p < m_end && !isBlank(*m_p) && *m_p != '\n') {
+            // "a/**/b" must not become "ab"
+            *m_o++ = ' ';
+        }
+    }
+
+    // End of the quoted text starting at from, after the closing quote.
+    // Backslash escapes the next byte. Quotes that can't span lines end
+    // unclosed at the newline, so that a stray apostrophe, as in JSX text,
+    // takes nothing after its line with it.
+    const char* closingQuote(const char* from, char quote, bool singleLine = false) const {
+        while (from < m_end) {
+            if (*from == '\\') {
+                from += m_end - from >= 2 ? 2 : 1;
+            } else if (singleLine && *from == '\n') {
+                return from;
+            } else if (*from++ == quote) {
+                return from;
+            }
+        }
+        return m_end;
+    }
+
+    // The identifier right before from, in the input
+    QByteArray identifierBefore(const char* from) const {
+        const char* start = from;
+        while (start > m_begin && isIdentifier(static_cast<unsigned char>(start[-1]))) {
+            --start;
+        }
+        return QByteArray::fromRawData(start, from - start);
+    }
+
+    bool startsWith(const char* text) const {
+        const size_t length = std::strlen(text);
+        return m_end - m_p >= static_cast<qsizetype>(length) && std::memcmp(m_p, text, length) == 0;
+    }
+
+    void lexC() {
+        const char c = *m_p;
+        if (c == '\\') {
+            // Line continuations and the like go along with what they escape
+            putVerbatim(ahead(2));
+        } else if (c == '/') {
+            const char next = m_p + 1 < m_end ? m_p[1] : '\0';
+            if (next == '/' && m_syntax != Syntax::Css) {
+                // Up to the end of the line; a trailing backslash continues it
+                const char* eol = m_p;
+                do {
+                    eol = static_cast<const char*>(std::memchr(eol + 1, '\n', static_cast<size_t>(m_end - eol - 1)));
+                } while (eol && eol[-1] == '\\');
+                dropComment(eol ? eol : m_end);
+            } else if (next == '*') {
+                const char* close = find(m_p + 2, m_end, "*/", 2);
+                dropComment(close == m_end ? m_end : close + 2);
+            } else if (m_syntax == Syntax::Script && regexAllowed()) {
+                lexRegex();
+            } else {
+                put(m_p, m_p + 1);
+                ++m_p;
+            }
+        } else if (c == '"') {
+            lexCString();
+        } else if (c == '\'' && m_syntax == Syntax::C) {
+            lexCharLiteral();
+        } else {
+            // ' in CSS and scripts, on one line; ` in JavaScript templates,
+            // on as many as it takes
+            putVerbatim(closingQuote(m_p + 1, c, c != '`'));
+        }
+    }
+
+    void lexCString() {
+        const QByteArray prefix = identifierBefore(m_p);
+        if (prefix == "R" || prefix == "LR" || prefix == "uR" || prefix == "UR" || prefix == "u8R") {
+            // C++: R"delimiter( ... )delimiter"
+            const char* open = m_p + 1;
+            while (open < m_end && open - m_p <= kMaxRawDelimiter && *open != '(' &&
+                   *open != '\\' && *open != ')' && !isBlank(*open) && *open != '\n') {
+                ++open;
+            }
+            if (open < m_end && *open == '(') {
+                QByteArray terminator = ')' + QByteArray(m_p + 1, open - m_p - 1) + '"';
+                const char* close = find(open + 1, m_end, terminator.constData(), static_cast<size_t>(terminator.size()));
+                putVerbatim(close == m_end ? m_end : close + terminator.size());
+                return;
+            }
+        }
+
+        // Rust: r"...", r#"..."#, with as many # as it takes
+        const char* hashes = m_p;
+        while (hashes > m_begin && hashes[-1] == '#') {
+            --hashes;
+        }
+        const QByteArray rustPrefix = identifierBefore(hashes);
+        if (rustPrefix == "r" || rustPrefix == "br") {
+            const QByteArray terminator = '"' + QByteArray(m_p - hashes, '#');
+            const char* close = find(m_p + 1, m_end, terminator.constData(), static_cast<size_t>(terminator.size()));
+            putVerbatim(close == m_end ? m_end : close + terminator.size());
+            return;
+        }
+
+        // C#: @"...", where "" is a quote and backslash is just a backslash
+        if ((m_p > m_begin && m_p[-1] == '@') || (m_p - m_begin >= 2 && m_p[-1] == '$' && m_p[-2] == '@')) {
+            const char* s = m_p + 1;
+            while (s < m_end) {
+                if (*s == '"' && (s + 1 == m_end || s[1] != '"')) {
+                    ++s;
+                    break;
+                }
+                s += *s == '"' ? 2 : 1;
+            }
+            putVerbatim(s);
+            return;
+        }
+
+        // Java, Kotlin, Swift and Scala: """ text blocks """
+        if (startsWith("\"\"\"")) {
+            const char* close = find(m_p + 3, m_end, "\"\"\"", 3);
+            putVerbatim(close == m_end ? m_end : close + 3);
+            return;
+        }
+        putVerbatim(closingQuote(m_p + 1, '"', true));
+    }
+
+    // 'x' and '\n', but not Rust lifetimes or C++14 digit separators
+    void lexCharLiteral() {
+        const QByteArray prefix = identifierBefore(m_p);
+        if (prefix.isEmpty() || prefix == "L" || prefix == "u" || prefix == "U" || prefix == "u8") {
+            const char* s = m_p + 1;
+            while (m_end - s >= 2 && s - m_p <= kMaxCharLiteral && *s != '\n') {
+                if (*s == '\\') {
+                    s += 2;
+                } else if (*s++ == '\'') {
+                    putVerbatim(s);
+                    return;
+                }
+            }
+        }
+        put(m_p, m_p + 1);
+        ++m_p;
+    }
+
+    // A / where an operand is expected starts a JavaScript regex literal:
+    // at the start of a line, after an operator or after a keyword such as
+    // return. After an operand it divides.
+    bool regexAllowed() const {
+        const char* before = m_o;
+        while (before > m_lineStart && isBlank(before[-1])) {
+            --before;
+        }
+        if (before == m_lineStart) {
+            return true;
+        }
+        if (std::strchr("(,=:[!&|?{};+-*%<>~^", before[-1]) != nullptr) {
+            return true;
+        }
+        const char* word = before;
+        while (word > m_lineStart && isIdentifier(static_cast<unsigned char>(word[-1]))) {
+            --word;
+        }
+        static const char* const keywords[] = {
+            "return", "typeof", "instanceof", "in", "of", "new", "delete", "void",
+            "throw", "case", "do", "else", "yield", "await"
+        };
+        const size_t length = static_cast<size_t>(before - word);
+        for (const char* keyword : keywords) {
+            if (std::strlen(keyword) == length && std::memcmp(word, keyword, length) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void lexRegex() {
+        // Up to the closing / on the same line, past escapes and classes;
+        // without one it was a division after all
+        bool inClass = false;
+        for (const char* s = m_p + 1; s < m_end && *s != '\n'; ++s) {
+            if (*s == '\\') {
+                ++s;
+            } else if (*s == '[') {
+                inClass = true;
+            } else if (*s == ']') {
+                inClass = false;
+            } else if (*s == '/' && !inClass) {
+                putVerbatim(s + 1);
+                return;
+            }
+        }
+        put(m_p, m_p + 1);
+        ++m_p;
+    }
+
+    void lexHash() {
+        const char c = *m_p;
+        if (c == '\\') {
+            putVerbatim(ahead(2));
+        } else if (c == '#') {
+            // Only a # that starts a word starts a comment: not $# or
+            // url#fragment, and not the #! line
+            const bool startsWord = m_p == m_begin ? !startsWith("#!") : (isBlank(m_p[-1]) || m_p[-1] == '\n');
+            if (!startsWord) {
+                put(m_p, m_p + 1);
+                ++m_p;
+                return;
+            }
+            // CMake and Lua-style #[[ ... ]] and #[==[ ... ]==]
+            const char* open = m_p + 1;
+            if (open < m_end && *open == '[') {
+                const char* equals = open + 1;
+                while (equals < m_end && *equals == '=') {
+                    ++equals;
+                }
+                if (equals < m_end && *equals == '[') {
+                    const QByteArray terminator = ']' + QByteArray(equals - open - 1, '=') + ']';
+                    const char* close = find(equals + 1, m_end, terminator.constData(), static_cast<size_t>(terminator.size()));
+                    dropComment(close == m_end ? m_end : close + terminator.size());
+                    return;
+                }
+            }
+            const char* eol = static_cast<const char*>(std::memchr(m_p, '\n', static_cast<size_t>(m_end - m_p)));
+            dropComment(eol ? eol : m_end);
+        } else {
+            // Quotes after a word are apostrophes, unless the word is a
+            // Python string prefix
+            const QByteArray prefix = identifierBefore(m_p).toLower();
+            if (!prefix.isEmpty() && prefix != "r" && prefix != "b" && prefix != "f" && prefix != "u" &&
+                prefix != "rb" && prefix != "br" && prefix != "fr" && prefix != "rf") {
+                put(m_p, m_p + 1);
+                ++m_p;
+                return;
+            }
+            const char triple[] = {c, c, c, '\0'};
+            if (startsWith(triple)) {
+                const char* s = m_p + 3;
+                while (m_end - s >= 3 && std::memcmp(s, triple, 3) != 0) {
+                    s += *s == '\\' ? 2 : 1;
+                }
+                putVerbatim(m_end - s >= 3 ? s + 3 : m_end);
+                return;
+            }
+            putVerbatim(closingQuote(m_p + 1, c));
+        }
+    }
+
+    void lexMarkup() {
+        if (startsWith("<!--")) {
+            const char* close = find(m_p + 4, m_end, "-->", 3);
+            dropComment(close == m_end ? m_end : close + 3);
+        } else if (startsWith("<![CDATA[")) {
+            const char* close = find(m_p + 9, m_end, "]]>", 3);
+            putVerbatim(close == m_end ? m_end : close + 3);
+        } else {
+            put(m_p, m_p + 1);
+            ++m_p;
+        }
+    }
+
+    const Syntax m_syntax;
+    const bool* m_stop;
+    const char* const m_begin;
+    const char* m_p;
+    const char* const m_end;
+    QByteArray m_result;
+    char* m_out;
+    char* m_o;
+    char* m_lineStart;          // where the current output line starts
+    char* m_protect;            // end of the last string, never trimmed into
+    bool m_lineHadComment = false;
+    bool m_lastBlank = false;
+};
+
+} // namespace
+
+CommentStripper::Syntax CommentStripper::syntaxFor(QStringView fileName) {
+    static const QHash<QString, Syntax> syntaxes = [] {
+        QHash<QString, Syntax> table;
+        const QHash<QString, QString>& configured = FileExtensionConfig::getInstance().getCommentSyntax();
+        for (auto it = configured.cbegin(); it != configured.cend(); ++it) {
+            if (it.value() == "c") {
+                table.insert(it.key(), Syntax::C);
+            } else if (it.value() == "script") {
+                table.insert(it.key(), Syntax::Script);
+            } else if (it.value() == "css") {
+                table.insert(it.key(), Syntax::Css);
+            } else if (it.value() == "hash") {
+                table.insert(it.key(), Syntax::Hash);
+            } else if (it.value() == "markup") {
+                table.insert(it.key(), Syntax::Markup);
+            }
+        }
+        return table;
+    }();
+
+    const qsizetype dot = fileName.lastIndexOf('.');
+    if (dot != -1) {
+        const auto it = syntaxes.constFind(fileName.mid(dot + 1).toString().toLower());
+        if (it != syntaxes.cend()) {
+            return *it;
+        }
+    }
+    // Entries such as "makefile" or "dockerfile" name whole files
+    return syntaxes.value(fileName.toString().toLower(), Syntax::None);
+}
+
+QByteArray CommentStripper::strip(const QByteArray& content, Syntax syntax) {
+    if (syntax == Syntax::None || content.isEmpty()) {
+        return content;
+    }
+    return Lexer(content, syntax).run();
+}
@@ -0,0 +1,35 @@
+// CommentStripper.h
+#pragma once
+
+#include <QByteArray>
+#include <QStringView>
+
+// Takes comments and redundant whitespace out of exported source files.
+//
+// One pass per file with a lexer per comment syntax, which knows the
+// language's string forms (escapes, C++ and Rust raw strings, C# verbatim
+// strings, Python triple quotes, JavaScript template and regex literals)
+// well enough never to cut into one. Text between the bytes it stops at is
+// copied in bulk. Lines left empty by a removed comment are dropped,
+// trailing whitespace is trimmed and runs of blank lines become one;
+// indentation stays, since Python, YAML and Makefiles depend on it.
+//
+// Which files get which syntax comes from comment_syntax in the config.
+class CommentStripper {
+public:
+    enum class Syntax : quint8 {
+        None,
+        C,          // // and /* */: C, C++, Java, C#, Go, Rust, ...
+        Script,     // C, plus '...' strings and regex literals: JavaScript, PHP, Dart
+        Css,        // /* */ only, since // appears in unquoted URLs
+        Hash,       // #: Python, shell, Ruby, YAML, TOML, CMake, Makefiles
+        Markup      // <!-- -->: HTML, XML, Vue and Svelte templates
+    };
+
+    // By extension or, like the extension table, by whole file name
+    static Syntax syntaxFor(QStringView fileName);
+
+    // content, which must not contain \r\n, without comments; content
+    // itself for Syntax::None
+    static QByteArray strip(const QByteArray& content, Syntax syntax);
+};
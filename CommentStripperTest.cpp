@@ -0,0 +1,78 @@
+// CommentStripperTest.cpp
+//
+// Cases CommentStripper has got wrong before: strings and regex literals it
+// mistook for comments. Run by ctest; exits non-zero on the first mismatch.
+
+#include "CommentStripper.h"
+#include <cstdio>
+
+namespace {
+
+int failures = 0;
+
+void expect(const char* name, CommentStripper::Syntax syntax, const QByteArray& input, const QByteArray& expected) {
+    const QByteArray actual = CommentStripper::strip(input, syntax);
+    if (actual != expected) {
+        ++failures;
+        std::printf("FAIL %s\n  input:    %s\n  expected: %s\n  actual:   %s\n", name,
+                    input.constData(), expected.constData(), actual.constData());
+    }
+}
+
+} // namespace
+
+int main() {
+    using Syntax = CommentStripper::Syntax;
+
+    // Single-quoted strings in JavaScript, PHP and Dart are strings of any
+    // length, not character literals
+    expect("script single-quoted url", Syntax::Script,
+           "const url = 'https://example.com/api'; // endpoint\n",
+           "const url = 'https://example.com/api';\n");
+    expect("script single-quoted block comment opener", Syntax::Script,
+           "const glob = 'src/**/*.js'; /* all */\nrun(glob);\n",
+           "const glob = 'src/**/*.js';\nrun(glob);\n");
+    expect("script escaped quote", Syntax::Script,
+           "echo 'it\\'s // not a comment';\n",
+           "echo 'it\\'s // not a comment';\n");
+
+    // A lone apostrophe in JSX text takes the rest of its line at most, and
+    // the quotes after it stay in phase
+    expect("jsx apostrophe", Syntax::Script,
+           "return (\n  <p>Don't panic</p>\n);\nconst url = 'https://x'; // link\n",
+           "return (\n  <p>Don't panic</p>\n);\nconst url = 'https://x';\n");
+    expect("template literal spans lines", Syntax::Script,
+           "const t = `a\n// not a comment\n`; // gone\n",
+           "const t = `a\n// not a comment\n`;\n");
+
+    // C keeps the character literal heuristic: digit separators and Rust
+    // lifetimes are not strings
+    expect("c char literal", Syntax::C,
+           "char c = '/'; // slash\n",
+           "char c = '/';\n");
+    expect("c digit separator", Syntax::C,
+           "int n = 1'000'000; // million\n",
+           "int n = 1'000'000;\n");
+    expect("rust lifetime", Syntax::C,
+           "fn f<'a>(s: &'a str) {} // borrow\n",
+           "fn f<'a>(s: &'a str) {}\n");
+
+    // Regex literals after keywords and at the start of a line
+    expect("regex after return", Syntax::Script,
+           "return /[/*]/.test(s);\nkeep();\n",
+           "return /[/*]/.test(s);\nkeep();\n");
+    expect("regex after typeof", Syntax::Script,
+           "x = typeof /a\\/*b/;\nkeep(); /* gone */\n",
+           "x = typeof /a\\/*b/;\nkeep();\n");
+    expect("regex at line start", Syntax::Script,
+           "/[/*]/.exec(s);\nkeep();\n",
+           "/[/*]/.exec(s);\nkeep();\n");
+    expect("division stays division", Syntax::Script,
+           "a = b / c; // half\nd = e / f;\n",
+           "a = b / c;\nd = e / f;\n");
+
+    if (failures == 0) {
+        std::printf("All CommentStripper tests passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+#include "ContentCache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+namespace {
+// Path, record and bookkeeping of an entry, so entries without content
+// (binary files) count against the budgets too
+constexpr qint64 kEntryOverhead = 256;
+// Largest share of the memory budget one file may take
+constexpr qint64 kMaxEntryShare = 8;
+}
+
+ContentCache::ContentCache(qint64 memoryBytes, qint64 spillBytes)
+    : m_memoryLimit(qMax<qint64>(memoryBytes, 0))
+    , m_spillLimit(qMax<qint64>(spillBytes, 0)) {
+}
+
+ContentCache::~ContentCache() = default;
+
+qint64 ContentCache::cost(qint64 bytes) {
+    return bytes + kEntryOverhead;
+}
+
+bool ContentCache::keeps(qint64 fileSize) const {
+    return cost(fileSize) <= m_memoryLimit / kMaxEntryShare;
+}
+
+QString ContentCache::spillPath(qint64 id) const {
+    return m_spillDir->filePath(QString::number(id));
+}
+
+bool ContentCache::contains(const QString& filePath) {
+    QMutexLocker locker(&m_mutex);
+    return m_entries.contains(filePath);
+}
+
+bool ContentCache::find(const QString& filePath, const FileRecord& record, Segment& segment) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(filePath);
+    if (it == m_entries.end()) {
+        return false;
+    }
+    if (it->size != record.size || it->mtime != record.mtime || it->inode != record.inode) {
+        remove(filePath);
+        return false;
+    }
+
+    if (!it->spilled) {
+        m_memoryOrder.splice(m_memoryOrder.end(), m_memoryOrder, it->order);
+        segment = it->segment;
+        return true;
+    }
+
+    // Back into memory; the spill file has done its job
+    QByteArray bytes;
+    if (it->spilledBytes > 0) {
+        QFile file(spillPath(it->spillId));
+        if (file.open(QIODevice::ReadOnly)) {
+            bytes = file.readAll();
+        }
+        if (bytes.size() != it->spilledBytes) {
+            remove(filePath);
+            return false;
+        }
+        file.remove();
+    }
+    m_spillUsed -= cost(it->spilledBytes);
+    m_spillOrder.erase(it->order);
+    it->spilled = false;
+    it->segment.bytes = std::move(bytes);
+    m_memoryOrder.push_back(filePath);
+    it->order = std::prev(m_memoryOrder.end());
+    m_memoryUsed += cost(it->segment.bytes.size());
+    segment = it->segment;
+
+    evictMemory();
+    return true;
+}
+
+void ContentCache::insert(const QString& filePath, const FileRecord& record, const Segment& segment) {
+    if (cost(segment.bytes.size()) > m_memoryLimit / kMaxEntryShare) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    remove(filePath);
+
+    Entry entry;
+    entry.size = record.size;
+    entry.mtime = record.mtime;
+    entry.inode = record.inode;
+    entry.segment = segment;
+    m_memoryOrder.push_back(filePath);
+    entry.order = std::prev(m_memoryOrder.end());
+    m_memoryUsed += cost(segment.bytes.size());
+    m_entries.insert(filePath, entry);
+
+    evictMemory();
+}
+
+qint64 ContentCache::tokens(const QString& filePath, const FileRecord& record) {
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_entries.constFind(filePath);
+    if (it == m_entries.cend() ||
+        it->size != record.size || it->mtime != record.mtime || it->inode != record.inode) {
+        return -1;
+    }
+    return it->segment.tokens;
+}
+
+void ContentCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_memoryOrder.clear();
+    m_spillOrder.clear();
+    m_memoryUsed = 0;
+    m_spillUsed = 0;
+    m_spillDir.reset();
+}
+
+void ContentCache::remove(const QString& filePath) {
+    auto it = m_entries.find(filePath);
+    if (it == m_entries.end()) {
+        return;
+    }
+    if (it->spilled) {
+        if (it->spilledBytes > 0) {
+            QFile::remove(spillPath(it->spillId));
+        }
+        m_spillUsed -= cost(it->spilledBytes);
+        m_spillOrder.erase(it->order);
+    } else {
+        m_memoryUsed -= cost(it->segment.bytes.size());
+        m_memoryOrder.erase(it->order);
+    }
+    m_entries.erase(it);
+}
+
+void ContentCache::evictMemory() {
+    while (m_memoryUsed > m_memoryLimit && !m_memoryOrder.empty()) {
+        const QString filePath = m_memoryOrder.front();
+        Entry& entry = m_entries[filePath];
+        if (!spill(filePath, entry)) {
+            remove(filePath);
+        }
+    }
+    evictSpill();
+}
+
+bool ContentCache::spill(const QString& filePath, Entry& entry) {
+    const qint64 bytes = entry.segment.bytes.size();
+    if (cost(bytes) > m_spillLimit) {
+        return false;
+    }
+    if (!m_spillDir) {
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        QDir().mkpath(cacheDir);
+        m_spillDir = std::make_unique<QTemporaryDir>(QDir(cacheDir).filePath("content-cache-XXXXXX"));
+        if (!m_spillDir->isValid()) {
+            qWarning() << "Could not create content cache spill directory:" << m_spillDir->errorString();
+            m_spillDir.reset();
+            m_spillLimit = 0;
+            return false;
+        }
+    }
+
+    const qint64 id = m_nextSpillId++;
+    if (bytes > 0) {
+        QFile file(spillPath(id));
+        if (!file.open(QIODevice::WriteOnly) || file.write(entry.segment.bytes) != bytes) {
+            file.remove();
+            return false;
+        }
+    }
+
+    m_memoryUsed -= cost(bytes);
+    m_memoryOrder.erase(entry.order);
+    m_spillOrder.push_back(filePath);
+    entry.order = std::prev(m_spillOrder.end());
+    m_spillUsed += cost(bytes);
+    entry.spilled = true;
+    entry.spillId = id;
+    entry.spilledBytes = bytes;
+    entry.segment.bytes = QByteArray();
+    return true;
+}
+
+void ContentCache::evictSpill() {
+    while (m_spillUsed > m_spillLimit && !m_spillOrder.empty()) {
+        const QString filePath = m_spillOrder.front();
+        remove(filePath);
+    }
+}
@@ -0,0 +1,89 @@
+// ContentCache.h
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <list>
+#include <memory>
+#include "FileReader.h"
+#include "ScanSnapshot.h"
+
+class QTemporaryDir;
+
+// What exports read from each file, kept between exports.
+//
+// Copying to the clipboard and then saving the same selection, or exporting
+// again after editing one file, only reads the files whose size, mtime or
+// inode changed since they were cached; the rest are spliced in from here.
+// Callers look files up by a stat taken just before, not by what the scan
+// recorded, which may be older than the file.
+//
+// Entries are kept in memory up to a byte budget, least recently used going
+// first. With a spill budget, entries pushed out of memory go to a
+// temporary directory under the cache location instead, removed with the
+// cache. Shared by the export's reader threads.
+class ContentCache {
+public:
+    // A file as the export renders it
+    struct Segment {
+        FileReader::Result result = FileReader::Result::Read;   // Read or Binary
+        QByteArray bytes;           // contents as valid UTF-8
+        qint64 bytesRead = 0;
+        qsizetype firstInvalid = -1;
+        int replacements = 0;
+        quint64 hash = 0;
+        qint64 hashedBytes = 0;
+        qint64 tokens = 0;          // of bytes, estimated
+        qint64 bytesStripped = 0;   // comments and whitespace taken out
+        bool truncated = false;     // bytes are the file's two ends only
+    };
+
+    ContentCache(qint64 memoryBytes, qint64 spillBytes);
+    ~ContentCache();
+
+    // Whether a file of this size would be kept; larger ones aren't worth
+    // pushing everything else out for
+    bool keeps(qint64 fileSize) const;
+
+    // Whether anything is cached for filePath, however old; lets callers
+    // skip measuring files the cache has never seen
+    bool contains(const QString& filePath);
+    // False when filePath isn't cached as record describes it
+    bool find(const QString& filePath, const FileRecord& record, Segment& segment);
+    void insert(const QString& filePath, const FileRecord& record, const Segment& segment);
+    // Token count of a cached file, or -1; doesn't count as a use
+    qint64 tokens(const QString& filePath, const FileRecord& record);
+    void clear();
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 mtime = 0;
+        quint64 inode = 0;
+        Segment segment;
+        bool spilled = false;       // bytes are in the spill file
+        qint64 spillId = 0;
+        qint64 spilledBytes = 0;
+        std::list<QString>::iterator order;     // in m_memoryOrder or m_spillOrder
+    };
+
+    static qint64 cost(qint64 bytes);
+    QString spillPath(qint64 id) const;
+    void remove(const QString& filePath);
+    void evictMemory();
+    bool spill(const QString& filePath, Entry& entry);
+    void evictSpill();
+
+    const qint64 m_memoryLimit;
+    qint64 m_spillLimit;
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    std::list<QString> m_memoryOrder;   // least recently used first
+    std::list<QString> m_spillOrder;    // oldest spill first
+    qint64 m_memoryUsed = 0;
+    qint64 m_spillUsed = 0;
+    qint64 m_nextSpillId = 0;
+    std::unique_ptr<QTemporaryDir> m_spillDir;  // made on the first spill
+};
@@ -0,0 +1,122 @@
+#include "ContentHash.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+constexpr quint64 kPrime1 = 11400714785074694791ULL;
+constexpr quint64 kPrime2 = 14029467366897019727ULL;
+constexpr quint64 kPrime3 = 1609587929392839161ULL;
+constexpr quint64 kPrime4 = 9650029242287828579ULL;
+constexpr quint64 kPrime5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Unaligned little-endian loads; memcpy compiles to a plain load
+inline quint64 read64(const unsigned char* p) {
+    quint64 value;
+    std::memcpy(&value, p, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+inline quint32 read32(const unsigned char* p) {
+    quint32 value;
+    std::memcpy(&value, p, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+inline quint64 round(quint64 acc, quint64 input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline quint64 mergeRound(quint64 hash, quint64 acc) {
+    hash ^= round(0, acc);
+    return hash * kPrime1 + kPrime4;
+}
+
+// One 32-byte stripe into the four lanes
+inline void consumeStripe(quint64* acc, const unsigned char* p) {
+    acc[0] = round(acc[0], read64(p));
+    acc[1] = round(acc[1], read64(p + 8));
+    acc[2] = round(acc[2], read64(p + 16));
+    acc[3] = round(acc[3], read64(p + 24));
+}
+
+} // namespace
+
+ContentHash::ContentHash(quint64 seed)
+    : m_seed(seed)
+    , m_acc{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1} {
+}
+
+void ContentHash::update(const char* data, qsizetype size) {
+    if (size <= 0) {
+        return;
+    }
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + size;
+    m_length += size;
+
+    // Top up a stripe left over from the last piece first
+    if (m_buffered > 0) {
+        const int taken = static_cast<int>(qMin<qsizetype>(size, 32 - m_buffered));
+        std::memcpy(m_buffer + m_buffered, p, static_cast<size_t>(taken));
+        m_buffered += taken;
+        p += taken;
+        if (m_buffered < 32) {
+            return;
+        }
+        consumeStripe(m_acc, m_buffer);
+        m_buffered = 0;
+    }
+
+    // Straight from the caller's buffer, no copying
+    while (end - p >= 32) {
+        consumeStripe(m_acc, p);
+        p += 32;
+    }
+
+    m_buffered = static_cast<int>(end - p);
+    std::memcpy(m_buffer, p, static_cast<size_t>(m_buffered));
+}
+
+quint64 ContentHash::digest() const {
+    quint64 hash;
+    if (m_length >= 32) {
+        hash = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) + rotl(m_acc[3], 18);
+        for (quint64 acc : m_acc) {
+            hash = mergeRound(hash, acc);
+        }
+    } else {
+        hash = m_seed + kPrime5;
+    }
+    hash += static_cast<quint64>(m_length);
+
+    // The tail that didn't fill a stripe
+    const unsigned char* p = m_buffer;
+    const unsigned char* const end = m_buffer + m_buffered;
+    for (; end - p >= 8; p += 8) {
+        hash ^= round(0, read64(p));
+        hash = rotl(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (end - p >= 4) {
+        hash ^= static_cast<quint64>(read32(p)) * kPrime1;
+        hash = rotl(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= *p * kPrime5;
+        hash = rotl(hash, 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
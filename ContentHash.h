@@ -0,0 +1,26 @@
+// ContentHash.h
+#pragma once
+
+#include <QtGlobal>
+
+// 64-bit XXH64 of a file's bytes, fed in whatever pieces they are read in.
+//
+// Used to spot files with the same content during an export. It is fast
+// (several GB/s, well above disk speed) and not meant to resist anyone
+// crafting collisions.
+class ContentHash {
+public:
+    explicit ContentHash(quint64 seed = 0);
+
+    void update(const char* data, qsizetype size);
+    // Hash of everything fed so far; more can still be fed afterwards
+    quint64 digest() const;
+    qint64 length() const { return m_length; }
+
+private:
+    quint64 m_seed;
+    quint64 m_acc[4];
+    qint64 m_length = 0;
+    unsigned char m_buffer[32];
+    int m_buffered = 0;
+};
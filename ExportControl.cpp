@@ -0,0 +1,30 @@
+#include "ExportControl.h"
+
+void ExportControl::cancel() {
+    QMutexLocker locker(&m_mutex);
+    m_cancelled = true;
+    m_resumed.wakeAll();
+}
+
+void ExportControl::pause() {
+    QMutexLocker locker(&m_mutex);
+    m_paused = true;
+}
+
+void ExportControl::resume() {
+    QMutexLocker locker(&m_mutex);
+    m_paused = false;
+    m_resumed.wakeAll();
+}
+
+bool ExportControl::checkpoint() const {
+    // The common case costs two relaxed loads
+    if (!m_paused.load(std::memory_order_relaxed)) {
+        return !isCancelled();
+    }
+    QMutexLocker locker(&m_mutex);
+    while (m_paused && !m_cancelled) {
+        m_resumed.wait(&m_mutex);
+    }
+    return !isCancelled();
+}
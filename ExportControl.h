@@ -0,0 +1,31 @@
+// ExportControl.h
+#pragma once
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+// Cancel, pause and resume for a running export.
+//
+// The UI only flips flags. The worker and its readers call checkpoint()
+// between files and between chunks of a file, so a cancelled export
+// returns within one chunk and a paused one holds no lock the UI needs.
+class ExportControl {
+public:
+    // Also releases a pause, so paused threads see the cancellation
+    void cancel();
+    void pause();
+    void resume();
+
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+    bool isPaused() const { return m_paused.load(std::memory_order_relaxed); }
+
+    // Waits while paused; false once the export is cancelled
+    bool checkpoint() const;
+
+private:
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<bool> m_paused{false};
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_resumed;
+};
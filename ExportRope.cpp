@@ -0,0 +1,46 @@
+#include "ExportRope.h"
+
+namespace {
+
+// Pieces below this are copied rather than shared, so that 100,000 files
+// don't make 300,000 chunks
+constexpr qsizetype kShareFrom = 4 * 1024;
+constexpr qsizetype kGatheredChunk = 64 * 1024;
+
+} // namespace
+
+void ExportRope::append(const QByteArray& bytes) {
+    if (bytes.size() < kShareFrom) {
+        append(bytes.constData(), bytes.size());
+        return;
+    }
+    m_chunks.append(bytes);
+    m_size += bytes.size();
+    m_lastGathered = false;
+}
+
+void ExportRope::append(const char* data, qsizetype size) {
+    if (size <= 0) {
+        return;
+    }
+    if (!m_lastGathered || m_chunks.last().size() + size > kGatheredChunk) {
+        QByteArray chunk;
+        chunk.reserve(qMax(size, kGatheredChunk));
+        m_chunks.append(chunk);
+        m_lastGathered = true;
+    }
+    m_chunks.last().append(data, size);
+    m_size += size;
+}
+
+QByteArray ExportRope::toByteArray() const {
+    if (m_chunks.size() == 1) {
+        return m_chunks.first();
+    }
+    QByteArray bytes;
+    bytes.reserve(m_size);
+    for (const QByteArray& chunk : m_chunks) {
+        bytes.append(chunk);
+    }
+    return bytes;
+}
@@ -0,0 +1,34 @@
+// ExportRope.h
+#pragma once
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QVector>
+
+// An export's output as a list of UTF-8 chunks, in order.
+//
+// Files go in as the buffers they were read into, or taken from the
+// content cache, without being copied; headers and other small pieces are
+// gathered into chunks of their own. Copies share the chunks, so handing a
+// rope through signals and lambdas costs a reference count, not the
+// output. It is flattened only when a consumer needs one contiguous buffer.
+class ExportRope {
+public:
+    // Shares bytes when they are large enough to be worth a chunk
+    void append(const QByteArray& bytes);
+    void append(const char* data, qsizetype size);
+
+    qint64 size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    const QVector<QByteArray>& chunks() const { return m_chunks; }
+
+    // The whole output in one buffer
+    QByteArray toByteArray() const;
+
+private:
+    QVector<QByteArray> m_chunks;
+    qint64 m_size = 0;
+    bool m_lastGathered = false;    // the last chunk takes small pieces
+};
+
+Q_DECLARE_METATYPE(ExportRope)
@@ -0,0 +1,173 @@
+// ExportTest.cpp
+//
+// What FileProcessingWorker costs in filesystem round trips with the
+// content cache on: a save that leaves the cache unused stats no path, and
+// exports that use the cache go by the opened file, not by a second lookup
+// of its path. Run by ctest; exits non-zero on the first failure.
+//
+// Path stats are counted by replacing stat() for this executable, which
+// glibc 2.33 and later let a program do. Elsewhere the test only checks
+// what the exports produce.
+
+#include "ContentCache.h"
+#include "FileProcessingWorker.h"
+#include "FilterEngine.h"
+#include "ParallelTreeWalker.h"
+#include "ScanSnapshot.h"
+#include <QBitArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+#define COUNT_PATH_STATS 1
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace {
+std::atomic<const char*> countedRoot{nullptr};
+std::atomic<int> pathStats{0};
+}
+
+// Every stat() of a path under countedRoot is one more round trip
+extern "C" int stat(const char* path, struct stat* buffer) noexcept {
+    const char* root = countedRoot.load();
+    if (root && std::strncmp(path, root, std::strlen(root)) == 0) {
+        pathStats.fetch_add(1);
+    }
+    return ::fstatat(AT_FDCWD, path, buffer, 0);
+}
+#endif
+
+namespace {
+
+constexpr int kFileCount = 16;
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        ++failures;
+        std::printf("FAIL %s\n", what);
+    }
+}
+
+bool writeFile(const QString& path, const QByteArray& content) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+}
+
+struct Export {
+    bool finished = false;
+    int cachedFiles = 0;
+    int pathStats = 0;
+    QByteArray output;
+};
+
+// Exports every accepted file, to outputPath or, without one, as the
+// clipboard gets it
+Export runExport(const QSharedPointer<const ScanSnapshot>& snapshot, const QSharedPointer<ContentCache>& cache,
+                 const QString& outputPath) {
+    QBitArray selectedFiles(snapshot->nodeCount());
+    for (int node = 1; node < snapshot->nodeCount(); ++node) {
+        if (!snapshot->isDirectory(node) && snapshot->isAccepted(node)) {
+            selectedFiles.setBit(node);
+        }
+    }
+
+    Export result;
+    FileProcessingWorker worker(snapshot, selectedFiles);
+    worker.setContentCache(cache);
+    if (!outputPath.isEmpty()) {
+        worker.setOutputPath(outputPath);
+    }
+    QObject::connect(&worker, &FileProcessingWorker::finished, [&result](const ExportRope& rope) {
+        result.finished = true;
+        result.output = rope.toByteArray();
+    });
+    QObject::connect(&worker, &FileProcessingWorker::error, [](const QString& message) {
+        std::printf("export failed: %s\n", qPrintable(message));
+    });
+
+#ifdef COUNT_PATH_STATS
+    const QByteArray root = QFile::encodeName(snapshot->rootPath() + '/');
+    pathStats.store(0);
+    countedRoot.store(root.constData());
+#endif
+    worker.process();
+#ifdef COUNT_PATH_STATS
+    countedRoot.store(nullptr);
+    result.pathStats = pathStats.load();
+#endif
+    result.cachedFiles = worker.progress()->cachedFiles.load();
+    if (result.finished && !outputPath.isEmpty()) {
+        QFile file(outputPath);
+        if (file.open(QIODevice::ReadOnly)) {
+            result.output = file.readAll();
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir tree;
+    QTemporaryDir outputDirectory;
+    if (!tree.isValid() || !outputDirectory.isValid()) {
+        std::printf("FAIL could not create temporary directories\n");
+        return 1;
+    }
+    const QString rootPath = QDir::cleanPath(tree.path());
+    for (int i = 0; i < kFileCount; ++i) {
+        if (!writeFile(QString("%1/file%2.cpp").arg(rootPath).arg(i), QByteArray("int value") +
+                       QByteArray::number(i) + " = " + QByteArray::number(i) + ";\n")) {
+            std::printf("FAIL could not write the tree\n");
+            return 1;
+        }
+    }
+
+    ParallelTreeWalker walker(QSharedPointer<const FilterEngine>::create(rootPath));
+    walker.walk();
+    const QSharedPointer<ScanSnapshot> snapshot = walker.snapshot();
+    if (!snapshot) {
+        std::printf("FAIL could not scan %s\n", qPrintable(rootPath));
+        return 1;
+    }
+
+    // A save into an empty cache copies every file and stats no path
+    const auto cache = QSharedPointer<ContentCache>::create(16 * 1024 * 1024, 0);
+    const Export saved = runExport(snapshot, cache, outputDirectory.filePath("saved.txt"));
+    check(saved.finished, "save finished");
+    check(saved.output.contains("int value7 = 7;"), "save holds the files");
+    check(saved.cachedFiles == 0, "save found nothing cached");
+    check(saved.pathStats == 0, "save with the cache unused stats no path");
+
+    // The clipboard fills the cache, and the next export takes every file
+    // from it, still without a path stat
+    const Export first = runExport(snapshot, cache, QString());
+    check(first.finished && first.output.contains("int value7 = 7;"), "first clipboard export");
+    check(first.pathStats == 0, "clipboard export stats no path");
+    const Export second = runExport(snapshot, cache, QString());
+    check(second.finished && second.output == first.output, "cached export matches");
+    check(second.cachedFiles == kFileCount, "every file taken from the cache");
+    check(second.pathStats == 0, "cache hits stat no path");
+
+    // An edit the scan never saw is still noticed through the opened file
+    writeFile(rootPath + "/file3.cpp", "int value3 = 333333;\n");
+    const Export edited = runExport(snapshot, cache, QString());
+    check(edited.output.contains("int value3 = 333333;"), "edited file re-read");
+    check(edited.cachedFiles == kFileCount - 1, "unchanged files taken from the cache");
+    check(edited.pathStats == 0, "edited export stats no path");
+
+    if (failures == 0) {
+        std::printf("All export tests passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
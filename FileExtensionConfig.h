@@ -4,6 +4,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QFile>
+#include <QHash>
 #include <QStringList>
 
 
@@ -14,19 +15,63 @@ public:
         return instance;
     }
 
-    QStringList getAllowedExtensions() const { return m_textExtensions; }
-    QStringList getExcludedDirectories() const { return m_excludedDirectories; }
+    // Reads settings from path, in the format of the built-in
+    // file_extensions.json, instead; only before the first getInstance()
+    static void setConfigPath(const QString& path) { configPath() = path; }
+
+    const QStringList& getAllowedExtensions() const { return m_textExtensions; }
+    const QStringList& getExcludedDirectories() const { return m_excludedDirectories; }
     qint64 getMaxFileSizeMB() const { return m_maxFileSizeMB; }
+    // Leading bytes checked for binary content; 0 turns the check off
+    int getBinarySniffBytes() const { return m_binarySniffBytes; }
+    int getBinaryMaxControlPercent() const { return m_binaryMaxControlPercent; }
+    // Threads reading files during an export; 0 = ideal thread count
+    int getExportThreads() const { return m_exportThreads; }
+    // Files whose content was already exported become a reference to it
+    bool getDeduplicateFiles() const { return m_deduplicateFiles; }
+    // What exports read, kept for the next one; 0 turns the cache off
+    int getContentCacheMB() const { return m_contentCacheMB; }
+    // Disk space for cache entries pushed out of memory; 0 = none
+    int getContentCacheSpillMB() const { return m_contentCacheSpillMB; }
+    // Whether saving to a file fills the cache too. Off, saves copy files
+    // the cache doesn't have inside the kernel; on, they read them into
+    // memory so that the next export can skip them.
+    bool getContentCacheOnSave() const { return m_contentCacheOnSave; }
+    // Estimated tokens an export may hold; 0 = no limit
+    qint64 getTokenBudget() const { return m_tokenBudget; }
+    // "stop" ends the export at the first file that doesn't fit; "fit"
+    // leaves out the largest files and skips any that still don't fit
+    bool getTokenBudgetStops() const { return m_tokenBudgetStops; }
+    // Largest part file a saved export is split into; 0 = one file
+    qint64 getShardMaxMB() const { return m_shardMaxMB; }
+    // Start a new part where the top-level directory changes, once the
+    // current one is half full
+    bool getShardByDirectory() const { return m_shardByDirectory; }
+    // Take comments, trailing whitespace and repeated blank lines out of
+    // files with a comment syntax
+    bool getStripComments() const { return m_stripComments; }
+    // Lower-case extension or file name -> "c", "script", "css", "hash" or
+    // "markup"
+    const QHash<QString, QString>& getCommentSyntax() const { return m_commentSyntax; }
+    // Files larger than this are exported as their first and last
+    // truncate_keep_kb, and no longer too large to export; 0 = off
+    qint64 getTruncateAboveKB() const { return m_truncateAboveKB; }
+    qint64 getTruncateKeepKB() const { return m_truncateKeepKB; }
 
 private:
     FileExtensionConfig() {
         loadConfig();
     }
 
+    static QString& configPath() {
+        static QString path = ":/config/file_extensions.json";
+        return path;
+    }
+
     void loadConfig() {
-        QFile configFile(":/config/file_extensions.json");
+        QFile configFile(configPath());
         if (!configFile.open(QIODevice::ReadOnly)) {
-            qWarning() << "Could not open file extensions config file";
+            qWarning() << "Could not open file extensions config file" << configPath();
             return;
         }
 
@@ -52,9 +97,64 @@ private:
 
         // Parse max file size
         m_maxFileSizeMB = configObj["max_file_size_mb"].toInt(10);
+
+        // Parse binary detection
+        m_binarySniffBytes = qMax(0, configObj["binary_sniff_bytes"].toInt(8192));
+        m_binaryMaxControlPercent = qBound(0, configObj["binary_max_control_percent"].toInt(10), 100);
+
+        // Parse export concurrency
+        m_exportThreads = qMax(0, configObj["export_threads"].toInt(0));
+
+        // Parse deduplication
+        m_deduplicateFiles = configObj["deduplicate_files"].toBool(true);
+
+        // Parse content cache
+        m_contentCacheMB = qMax(0, configObj["content_cache_mb"].toInt(256));
+        m_contentCacheSpillMB = qMax(0, configObj["content_cache_spill_mb"].toInt(0));
+        m_contentCacheOnSave = configObj["content_cache_on_save"].toBool(false);
+
+        // Parse token budget
+        m_tokenBudget = qMax<qint64>(0, configObj["token_budget"].toInteger(0));
+        m_tokenBudgetStops = configObj["token_budget_mode"].toString("fit") == "stop";
+
+        // Parse sharding
+        m_shardMaxMB = qMax<qint64>(0, configObj["shard_max_mb"].toInteger(0));
+        m_shardByDirectory = configObj["shard_by_directory"].toBool(false);
+
+        // Parse comment stripping
+        m_stripComments = configObj["strip_comments"].toBool(false);
+        QJsonObject syntaxObj = configObj["comment_syntax"].toObject();
+        for (auto it = syntaxObj.constBegin(); it != syntaxObj.constEnd(); ++it) {
+            for (const QJsonValue& ext : it.value().toArray()) {
+                m_commentSyntax.insert(ext.toString().toLower(), it.key());
+            }
+        }
+
+        // Parse truncation of large files; the ends kept must fit below the
+        // threshold
+        m_truncateKeepKB = qMax<qint64>(1, configObj["truncate_keep_kb"].toInteger(64));
+        m_truncateAboveKB = qMax<qint64>(0, configObj["truncate_above_kb"].toInteger(0));
+        if (m_truncateAboveKB > 0) {
+            m_truncateAboveKB = qMax(m_truncateAboveKB, 2 * m_truncateKeepKB);
+        }
     }
 
     QStringList m_textExtensions;
     QStringList m_excludedDirectories;
     qint64 m_maxFileSizeMB;
+    int m_binarySniffBytes = 8192;
+    int m_binaryMaxControlPercent = 10;
+    int m_exportThreads = 0;
+    bool m_deduplicateFiles = true;
+    int m_contentCacheMB = 256;
+    int m_contentCacheSpillMB = 0;
+    bool m_contentCacheOnSave = false;
+    qint64 m_tokenBudget = 0;
+    bool m_tokenBudgetStops = false;
+    qint64 m_shardMaxMB = 0;
+    bool m_shardByDirectory = false;
+    bool m_stripComments = false;
+    QHash<QString, QString> m_commentSyntax;
+    qint64 m_truncateAboveKB = 0;
+    qint64 m_truncateKeepKB = 64;
 };
\ No newline at end of file
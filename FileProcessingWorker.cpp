@@ -1,76 +1,530 @@
 #include "FileProcessingWorker.h"
-#include "FileSystemModelWithGitIgnore.h"
-#include "FileProcessableUtils.h"
+#include "BlockCompressor.h"
+#include "CommentStripper.h"
+#include "ContentCache.h"
+#include "ContentHash.h"
 #include "FileExtensionConfig.h"
-#include <QFile>
-#include <QTextStream>
-#include <QRegularExpression>
-#include <QFileInfo>
+#include "FileReader.h"
+#include "ShardWriter.h"
+#include "TokenCounter.h"
+#include "Utf8Validator.h"
+#include "WorkStealingThreadPool.h"
 #include <QDebug>
-#include <QThread>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QWaitCondition>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// One file as read by the pool, or found in the cache, waiting for its
+// turn in the output
+struct ReadSlot : ContentCache::Segment {
+    OpenedFile source;      // the file itself, when it can be copied as it is
+    QString errorString;
+    bool ready = false;
+};
+
+// How far reading may run ahead of the file being appended
+constexpr int kFilesAheadPerThread = 4;
+constexpr qint64 kBytesAhead = 64 * 1024 * 1024;
+
+// The first file seen with some content
+struct FirstCopy {
+    qint64 length;
+    size_t index;
+    QByteArray bytes;       // as exported, when the output is kept in memory anyway
+    int shard;              // part it went into; references don't cross parts
+};
+
+// Whether two files hold the same bytes, compared a chunk at a time; only
+// asked once their hashes and lengths agree, so it is mostly reading
+// what the page cache still has
+bool sameFileContent(const QString& firstPath, const QString& secondPath) {
+    QFile first(firstPath);
+    QFile second(secondPath);
+    if (!first.open(QIODevice::ReadOnly) || !second.open(QIODevice::ReadOnly) ||
+        first.size() != second.size()) {
+        return false;
+    }
+    constexpr qint64 kChunk = 256 * 1024;
+    for (;;) {
+        const QByteArray a = first.read(kChunk);
+        const QByteArray b = second.read(kChunk);
+        if (a != b) {
+            return false;
+        }
+        if (a.isEmpty()) {
+            return !first.error() && !second.error();
+        }
+    }
+}
+
+// One part file of a saved export and what went into it
+struct OutputShard {
+    std::unique_ptr<ShardWriter> writer;
+    QString directory;      // top-level directory of the last file written
+    QStringList files;
+    qint64 bytes = 0;
+    qint64 tokens = 0;
+};
+
+// Every part starts with one
+constexpr qint64 kBomBytes = 3;
+
+QString topDirectory(const QString& relativePath) {
+    return relativePath.contains('/') ? relativePath.section('/', 0, 0) : QString();
+}
+
+// export.txt.gz is split into export.part001.txt.gz, ... listed in
+// export.manifest.json
+void splitOutputName(const QString& outputPath, QString& stem, QString& suffix) {
+    stem = QFileInfo(outputPath).fileName();
+    suffix.clear();
+    if (BlockCompressor::formatForPath(outputPath) != BlockCompressor::Format::None) {
+        const qsizetype dot = stem.lastIndexOf('.');
+        suffix = stem.mid(dot);
+        stem.truncate(dot);
+    }
+    const qsizetype dot = stem.lastIndexOf('.');
+    if (dot > 0) {
+        suffix.prepend(stem.mid(dot));
+        stem.truncate(dot);
+    }
+}
+
+} // namespace
 
 FileProcessingWorker::FileProcessingWorker(
-    const QString& path, 
-    const std::set<QString>& files,
-    FileSystemModelWithGitIgnore* model,
+    const QSharedPointer<const ScanSnapshot>& scanSnapshot,
+    const QBitArray& files,
     QObject* parent
 ) : QObject(parent)
-  , rootPath(path)
+  , snapshot(scanSnapshot)
   , selectedFiles(files)
-  , fileModel(model)
+  , progressCounters(QSharedPointer<ProcessingProgress>::create())
+  , exportControl(QSharedPointer<ExportControl>::create())
   , totalProcessedSize(0) {
 }
 
+qint64 FileProcessingWorker::estimateTokens(ContentCache* cache, const QString& filePath,
+                                           const FileRecord& record) {
+    const qint64 cached = cache ? cache->tokens(filePath, record) : -1;
+    return cached >= 0 ? cached : TokenCounter::estimateFromSize(FileReader::exportedSize(record.size));
+}
+
 void FileProcessingWorker::process() {
-    QString result;
-    QDir baseDir(rootPath);
-    
-    // Filter out non-processable files first
-    std::set<QString> processableFiles;
-    for (const QString& filePath : selectedFiles) {
-        if (isFileProcessableImpl(filePath)) {
-            processableFiles.insert(filePath);
+    // Bytes stay UTF-8 from the file to the output; nothing is decoded.
+    // Files join the result as the buffers they were read into.
+    ExportRope result;
+
+    // The selection only holds accepted files; don't evaluate or stat them
+    // again. Sorted by path, so the output doesn't depend on node order.
+    std::vector<std::pair<QString, FileRecord>> processableFiles;
+    processableFiles.reserve(static_cast<size_t>(selectedFiles.count(true)));
+    for (qsizetype node = 0; node < selectedFiles.size(); ++node) {
+        if (selectedFiles.testBit(node)) {
+            processableFiles.emplace_back(snapshot->relativePath(static_cast<int>(node)),
+                                          snapshot->record(static_cast<int>(node)));
         }
     }
-    
-    // Use processable files for total count
-    int totalFiles = processableFiles.size();
-    emit processingProgress(0, totalFiles);
+    std::sort(processableFiles.begin(), processableFiles.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // Fitting a token budget keeps as many files as it can: the largest are
+    // left out, by estimate, until the rest should fit. Counting files as
+    // they are read still holds the export to the budget.
+    const QString& rootPath = snapshot->rootPath();
+    const FileExtensionConfig& config = FileExtensionConfig::getInstance();
+    const qint64 tokenBudget = config.getTokenBudget();
+    int overBudgetFiles = 0;
+    if (tokenBudget > 0 && !config.getTokenBudgetStops()) {
+        std::vector<std::pair<qint64, size_t>> estimates;
+        estimates.reserve(processableFiles.size());
+        qint64 estimatedTotal = 0;
+        for (size_t index = 0; index < processableFiles.size(); ++index) {
+            const auto& [relativePath, record] = processableFiles[index];
+            const qint64 tokens = estimateTokens(contentCache.get(), rootPath + '/' + relativePath, record);
+            estimates.emplace_back(tokens, index);
+            estimatedTotal += tokens;
+        }
+        std::sort(estimates.begin(), estimates.end(), std::greater<>());
+        std::vector<bool> leftOut(processableFiles.size(), false);
+        for (const auto& [tokens, index] : estimates) {
+            if (estimatedTotal <= tokenBudget) {
+                break;
+            }
+            leftOut[index] = true;
+            estimatedTotal -= tokens;
+            overBudgetFiles++;
+        }
+        if (overBudgetFiles > 0) {
+            size_t kept = 0;
+            for (size_t index = 0; index < processableFiles.size(); ++index) {
+                if (!leftOut[index]) {
+                    processableFiles[kept++] = std::move(processableFiles[index]);
+                }
+            }
+            processableFiles.resize(kept);
+        }
+    }
+    progressCounters->overBudgetFiles.store(overBudgetFiles, std::memory_order_relaxed);
+
+    int totalFiles = static_cast<int>(processableFiles.size());
+    progressCounters->fileTokens.fill(-1, totalFiles);
+    progressCounters->files.reserve(totalFiles);
+    for (const auto& file : processableFiles) {
+        progressCounters->files.append(file.first);
+    }
+    progressCounters->totalFiles.store(totalFiles, std::memory_order_release);
 
     // Detailed processing log
     qDebug() << "Starting to process" << totalFiles << "files";
 
+    // Saving writes each file as soon as it is its turn, through a writer
+    // thread into a temporary file next to the destination; nothing is kept
+    // beyond the read-ahead and the writer's queue. A .gz or .zst
+    // destination gets compressed blocks instead.
+    const bool streaming = !outputPath.isEmpty();
+    const bool compressed = streaming &&
+                            BlockCompressor::formatForPath(outputPath) != BlockCompressor::Format::None;
+    // Standard output is one stream, which the kernel can't copy files into
+    const bool toStandardOutput = ShardWriter::isStandardOutput(outputPath);
+
+    // A saved export can be split into part files at file boundaries. Each
+    // file goes where its bytes as written still fit, BOM included, so no
+    // part grows past the cap unless one file alone is larger; the same
+    // files always give the same parts.
+    const qint64 shardMaxBytes = streaming && !toStandardOutput ? config.getShardMaxMB() * 1024 * 1024 : 0;
+    const bool sharded = shardMaxBytes > 0;
+    std::vector<OutputShard> shards;
+    QString shardStem;
+    QString shardSuffix;
+    splitOutputName(outputPath, shardStem, shardSuffix);
+    auto partPath = [&](int number) {
+        return QFileInfo(outputPath).dir().filePath(QString("%1.part%2%3")
+            .arg(shardStem)
+            .arg(number, 3, 10, QChar('0'))
+            .arg(shardSuffix));
+    };
+
+    // Files are read and decoded by a pool, in any order, into one slot
+    // each; this thread appends the slots in path order, so the output is
+    // the same as reading them one by one
+    const ExportControl& control = *exportControl;
+    const FileReader reader(&control);
+    const bool deduplicate = config.getDeduplicateFiles();
+    const bool stripComments = config.getStripComments();
+    const bool cacheOnSave = config.getContentCacheOnSave();
+    std::vector<ReadSlot> slots(processableFiles.size());
+    QMutex slotMutex;
+    QWaitCondition slotReady;
+
+    auto readFile = [&](size_t index) {
+        const auto& [relativePath, scanned] = processableFiles[index];
+        const QString filePath = rootPath + '/' + relativePath;
+        ContentCache::Segment segment;
+        QString errorString;
+        OpenedFile source;
+
+        // Files queued before a cancel are given up without being opened
+        if (!control.checkpoint()) {
+            segment.result = FileReader::Result::Cancelled;
+        } else {
+            const CommentStripper::Syntax syntax = stripComments
+                ? CommentStripper::syntaxFor(QStringView(relativePath).mid(relativePath.lastIndexOf('/') + 1))
+                : CommentStripper::Syntax::None;
+            // Saves copy files inside the kernel unless content_cache_on_save
+            // has them read into memory for the cache, so that the next
+            // export doesn't have to read them at all; stripped files have to
+            // be read to be stripped
+            const bool passThrough = streaming && !compressed && !toStandardOutput &&
+                                     syntax == CommentStripper::Syntax::None &&
+                                     !(cacheOnSave && contentCache && contentCache->keeps(scanned.size));
+            // The scan's record can predate an edit no watcher reported, so
+            // the cache goes by the file as the reader opened it. Only files
+            // the cache holds are looked up before reading.
+            FileRecord record = scanned;
+            FileReader::CacheLookup isCached;
+            if (contentCache && contentCache->contains(filePath)) {
+                isCached = [&](const FileRecord& opened) { return contentCache->find(filePath, opened, segment); };
+            }
+            QByteArray content;
+            ContentHash hash;
+            bool truncated = false;
+            const FileReader::Result result = reader.read(filePath, scanned, content, errorString,
+                                                          passThrough ? &source : nullptr,
+                                                          deduplicate ? &hash : nullptr, &truncated,
+                                                          contentCache ? &record : nullptr, isCached);
+            if (result == FileReader::Result::Cached) {
+                progressCounters->cachedFiles.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                segment.result = result;
+                segment.truncated = truncated;
+                // Files handed back open go from the page cache to the output
+                // untouched. Valid ones are passed on as read, sharing the
+                // buffer; only invalid ones are copied, with U+FFFD for each
+                // bad sequence.
+                if (segment.result == FileReader::Result::Read && !source.isOpen()) {
+                    segment.firstInvalid = Utf8Validator::firstInvalid(content);
+                    segment.bytes = segment.firstInvalid < 0
+                        ? content
+                        : Utf8Validator::repaired(content, segment.firstInvalid, &segment.replacements);
+                    // Truncated files aren't stripped: a comment cut open at
+                    // the end of the head would swallow the elision line
+                    if (syntax != CommentStripper::Syntax::None && !segment.truncated) {
+                        const qsizetype unstripped = segment.bytes.size();
+                        segment.bytes = CommentStripper::strip(segment.bytes, syntax);
+                        segment.bytesStripped = unstripped - segment.bytes.size();
+                    }
+                }
+                segment.hash = hash.digest();
+                segment.hashedBytes = hash.length();
+                segment.bytesRead = source.isOpen() ? source.size() : content.size();
+                // Counted here, on the pool, so appending doesn't wait for it;
+                // files copied by the kernel never reach this process
+                segment.tokens = source.isOpen() ? TokenCounter::estimateFromSize(segment.bytesRead)
+                                                 : TokenCounter::count(segment.bytes);
+
+                const bool cacheable = segment.result == FileReader::Result::Binary ||
+                                       (segment.result == FileReader::Result::Read && !source.isOpen());
+                if (record.size >= 0 && cacheable && contentCache) {
+                    contentCache->insert(filePath, record, segment);
+                }
+            }
+        }
+
+        QMutexLocker locker(&slotMutex);
+        ReadSlot& slot = slots[index];
+        static_cast<ContentCache::Segment&>(slot) = std::move(segment);
+        slot.source = std::move(source);
+        slot.errorString = std::move(errorString);
+        slot.ready = true;
+        slotReady.wakeAll();
+    };
+
+    // Declared last: tasks still running on an early return finish before
+    // the slots they write to go away
+    WorkStealingThreadPool pool(config.getExportThreads());
+
+    // Reading stays a bounded number of files and bytes ahead, and always
+    // at least one file
+    const size_t maxFilesAhead = static_cast<size_t>(pool.threadCount()) * kFilesAheadPerThread;
+    size_t submitted = 0;
+    qint64 bytesAhead = 0;
+    auto readAhead = [&](size_t appended) {
+        while (submitted < processableFiles.size() &&
+               (submitted == appended ||
+                (submitted - appended < maxFilesAhead && bytesAhead < kBytesAhead))) {
+            bytesAhead += qMax<qint64>(FileReader::exportedSize(processableFiles[submitted].second.size), 0);
+            pool.submit([&readFile, index = submitted]() { readFile(index); });
+            ++submitted;
+        }
+    };
+
     int processedFiles = 0;
-    for (const QString& filePath : processableFiles) {
-        // Emit current file being processed
-        emit currentFile(filePath);
-        
-        QFile file(filePath);
-        
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QByteArray content = file.readAll();
-            
-            // Get the relative path for output
-            QString relativePath = baseDir.relativeFilePath(filePath);
-            result += "=== " + relativePath + " ===\n";
-            result += QString::fromUtf8(content);
-            result += "\n\n";
+    int binaryFiles = 0;
+    qint64 bytesNotRead = 0;
+    // Content already in the output, by hash; a repeat becomes a reference
+    // to the first file, in path order. Equal hashes of equal lengths only
+    // make a candidate: the bytes are compared before anything is replaced,
+    // in memory when the output keeps them there and on disk otherwise.
+    QHash<quint64, FirstCopy> firstCopies;
+    int duplicateFiles = 0;
+    qint64 bytesDeduplicated = 0;
+    qint64 bytesStripped = 0;
+    int truncatedFiles = 0;
+    qint64 totalTokens = 0;
+    bool budgetReached = false;
+    int budgetSkippedFiles = 0;
+    // Returning early drops the unfinished output: QSaveFile only replaces
+    // the destination on commit()
+    auto stopCancelled = [&]() {
+        qDebug() << "Export cancelled after" << processedFiles << "files";
+        emit cancelled();
+    };
+    for (size_t index = 0; index < processableFiles.size() && !budgetReached; ++index) {
+        if (!control.checkpoint()) {
+            stopCancelled();
+            return;
+        }
+        readAhead(index);
+
+        ReadSlot slot;
+        {
+            QMutexLocker locker(&slotMutex);
+            while (!slots[index].ready) {
+                slotReady.wait(&slotMutex);
+            }
+            slot = std::move(slots[index]);
+        }
+        const FileRecord& record = processableFiles[index].second;
+        bytesAhead -= qMax<qint64>(FileReader::exportedSize(record.size), 0);
+        const QString filePath = rootPath + '/' + processableFiles[index].first;
+        progressCounters->currentFile.store(static_cast<int>(index), std::memory_order_relaxed);
+
+        if (slot.result == FileReader::Result::Cancelled) {
+            stopCancelled();
+            return;
+        } else if (slot.result == FileReader::Result::Binary) {
+            // Extensions can't tell a .log or .sqlite full of binary apart
+            binaryFiles++;
+            bytesNotRead += qMax<qint64>(record.size - slot.bytesRead, 0);
+            progressCounters->bytesNotRead.store(bytesNotRead, std::memory_order_relaxed);
+            progressCounters->binaryFiles.store(binaryFiles, std::memory_order_relaxed);
+        } else if (slot.result == FileReader::Result::Read) {
+            const QString& relativePath = processableFiles[index].first;
+            const QByteArray header = "=== " + relativePath.toUtf8() + " ===\n";
+
+            // The part is picked by the file's full size, before a reference
+            // could shrink it, so that references can stay within the part
+            int shard = shards.empty() ? 0 : static_cast<int>(shards.size()) - 1;
+            if (sharded && !shards.empty()) {
+                const OutputShard& current = shards.back();
+                const qint64 bytes = header.size() +
+                    (slot.source.isOpen() ? slot.source.size() : slot.bytes.size()) + 2;
+                const bool full = kBomBytes + current.bytes + bytes > shardMaxBytes;
+                const bool nextDirectory = config.getShardByDirectory() &&
+                                           topDirectory(relativePath) != current.directory &&
+                                           (kBomBytes + current.bytes) * 2 >= shardMaxBytes;
+                if (full || nextDirectory) {
+                    ++shard;
+                }
+            }
+
+            // A repeat of content already in the output becomes a reference
+            // to it; only worth it when the reference is shorter, and only
+            // within one part, so that each part reads on its own
+            QByteArray reference;
+            bool firstCopy = false;
+            if (deduplicate && slot.hashedBytes > 0) {
+                const auto copy = firstCopies.constFind(slot.hash);
+                if (copy == firstCopies.cend() || copy->shard != shard) {
+                    firstCopy = true;
+                } else if (copy->length == slot.hashedBytes) {
+                    reference = "(same content as " + processableFiles[copy->index].first.toUtf8() + ")\n";
+                    const bool same = reference.size() < slot.bytesRead &&
+                        (streaming ? sameFileContent(rootPath + '/' + processableFiles[copy->index].first, filePath)
+                                   : copy->bytes == slot.bytes);
+                    if (!same) {
+                        reference.clear();
+                    }
+                }
+            }
+
+            // The header and the blank line after the file count too
+            const qint64 fileTokens = TokenCounter::count(header) + 1 +
+                (reference.isEmpty() ? slot.tokens : TokenCounter::count(reference));
+            if (tokenBudget > 0 && totalTokens + fileTokens > tokenBudget) {
+                // Files passed over here are done as far as progress goes
+                const int skipped = config.getTokenBudgetStops()
+                    ? static_cast<int>(processableFiles.size() - index) : 1;
+                budgetReached = config.getTokenBudgetStops();
+                overBudgetFiles += skipped;
+                budgetSkippedFiles += skipped;
+                progressCounters->overBudgetFiles.store(overBudgetFiles, std::memory_order_relaxed);
+                progressCounters->budgetSkippedFiles.store(budgetSkippedFiles, std::memory_order_relaxed);
+                continue;
+            }
+            totalTokens += fileTokens;
+            progressCounters->fileTokens[static_cast<qsizetype>(index)] = fileTokens;
+            progressCounters->tokens.store(totalTokens, std::memory_order_relaxed);
+
+            if (firstCopy) {
+                firstCopies.insert(slot.hash, FirstCopy{slot.hashedBytes, index,
+                                                        streaming ? QByteArray() : slot.bytes, shard});
+            } else if (!reference.isEmpty()) {
+                duplicateFiles++;
+                bytesDeduplicated += slot.bytesRead - reference.size();
+                progressCounters->bytesDeduplicated.store(bytesDeduplicated, std::memory_order_relaxed);
+                progressCounters->duplicateFiles.store(duplicateFiles, std::memory_order_relaxed);
+                slot.bytes = reference;
+                slot.source = OpenedFile();
+                slot.firstInvalid = -1;
+            }
+            if (slot.truncated) {
+                truncatedFiles++;
+                progressCounters->truncatedFiles.store(truncatedFiles, std::memory_order_relaxed);
+            }
+            if (reference.isEmpty() && slot.bytesStripped > 0) {
+                bytesStripped += slot.bytesStripped;
+                progressCounters->bytesStripped.store(bytesStripped, std::memory_order_relaxed);
+            }
+
+            if (slot.firstInvalid >= 0) {
+                qWarning() << "Replaced" << slot.replacements << "invalid UTF-8 sequences in" << filePath
+                           << "starting at byte" << slot.firstInvalid;
+                progressCounters->repairedPaths.append(processableFiles[index].first);
+                progressCounters->repairedFiles.store(static_cast<int>(progressCounters->repairedPaths.size()),
+                                                      std::memory_order_relaxed);
+            }
+
+            if (streaming) {
+                // A part is opened with the first file written to it; the
+                // one before finishes on its own thread meanwhile
+                if (static_cast<int>(shards.size()) <= shard) {
+                    if (!shards.empty()) {
+                        shards.back().writer->close();
+                    }
+                    const QString path = sharded ? partPath(static_cast<int>(shards.size()) + 1) : outputPath;
+                    auto writer = std::make_unique<ShardWriter>(path, &control);
+                    if (!writer->open()) {
+                        emit error("Could not save the file: " + writer->errorString());
+                        return;
+                    }
+                    shards.push_back(OutputShard{std::move(writer)});
+                    progressCounters->shardFiles.store(static_cast<int>(shards.size()), std::memory_order_relaxed);
+                }
+
+                OutputShard& part = shards.back();
+                const qint64 contentBytes = slot.source.isOpen() ? slot.source.size() : slot.bytes.size();
+                bool written = part.writer->write(header);
+                if (written && slot.source.isOpen()) {
+                    written = part.writer->write(std::move(slot.source));
+                } else if (written) {
+                    written = part.writer->write(slot.bytes);
+                }
+                written = written && part.writer->write(QByteArray("\n\n", 2));
+                if (!written && control.isCancelled()) {
+                    stopCancelled();
+                    return;
+                }
+                if (!written) {
+                    emit error("Could not save the file: " + part.writer->errorString());
+                    return;
+                }
+                part.files.append(relativePath);
+                part.directory = topDirectory(relativePath);
+                part.bytes += header.size() + contentBytes + 2;
+                part.tokens += fileTokens;
+            } else {
+                result.append(header);
+                result.append(slot.bytes);
+                result.append("\n\n", 2);
+            }
             
             // Update total processed size
-            totalProcessedSize += content.size();
+            totalProcessedSize += slot.bytesRead;
             processedFiles++;
             
-            // Update progress and statistics
-            emit processingProgress(processedFiles, totalFiles);
-            emit statistics(processedFiles, totalProcessedSize);
-            
-            // Give the UI a chance to update and prevent UI freezing
-            QThread::msleep(1);
+            // The dialog picks these up on its own schedule
+            progressCounters->totalSize.store(totalProcessedSize, std::memory_order_relaxed);
+            progressCounters->processedFiles.store(processedFiles, std::memory_order_relaxed);
         } else {
             // Error handling for file open failures
             QString errorMessage = QString("Could not open file: %1 - %2")
-                                    .arg(filePath, file.errorString());
+                                    .arg(filePath, slot.errorString);
             qWarning() << errorMessage;
             emit error(errorMessage);
             return;
@@ -78,7 +532,7 @@ void FileProcessingWorker::process() {
     }
 
     // Final checks and signaling
-    if (result.isEmpty()) {
+    if (processedFiles == 0) {
         qWarning() << "No files were processed.";
         emit error("No files were processed. Please check your selection.");
         return;
@@ -87,6 +541,68 @@ void FileProcessingWorker::process() {
     // Log successful processing
     qDebug() << "Successfully processed" << processedFiles << "files"
              << "Total size:" << totalProcessedSize << "bytes";
+    if (binaryFiles > 0) {
+        qDebug() << "Skipped" << binaryFiles << "binary files, leaving" << bytesNotRead << "bytes unread";
+    }
+    if (overBudgetFiles > 0) {
+        qDebug() << "Left out" << overBudgetFiles << "files for the token budget, exporting ~"
+                 << totalTokens << "of" << tokenBudget << "tokens";
+    }
+
+    if (streaming) {
+        // Every part is written before any of them replaces its destination
+        for (OutputShard& shard : shards) {
+            if (!shard.writer->finish()) {
+                if (control.isCancelled()) {
+                    stopCancelled();
+                    return;
+                }
+                emit error("Could not save the file: " + shard.writer->errorString());
+                return;
+            }
+        }
+        for (OutputShard& shard : shards) {
+            if (!shard.writer->commit()) {
+                emit error("Could not save the file: " + shard.writer->errorString());
+                return;
+            }
+        }
+
+        if (sharded) {
+            QJsonArray parts;
+            for (const OutputShard& shard : shards) {
+                QJsonObject part;
+                part["file"] = QFileInfo(shard.writer->path()).fileName();
+                part["bytes"] = shard.bytes;
+                part["tokens"] = shard.tokens;
+                part["files"] = QJsonArray::fromStringList(shard.files);
+                parts.append(part);
+            }
+            QJsonObject manifest;
+            manifest["shard_max_bytes"] = shardMaxBytes;
+            manifest["shards"] = parts;
+
+            const QString manifestPath = QFileInfo(outputPath).dir().filePath(shardStem + ".manifest.json");
+            QSaveFile manifestFile(manifestPath);
+            if (!manifestFile.open(QIODevice::WriteOnly) ||
+                manifestFile.write(QJsonDocument(manifest).toJson()) < 0 ||
+                !manifestFile.commit()) {
+                emit error("Could not save the manifest: " + manifestFile.errorString());
+                return;
+            }
+            progressCounters->manifestPath = manifestPath;
+
+            // Parts numbered past these are left from an earlier export that
+            // had more, and would pass for part of this one
+            for (int number = static_cast<int>(shards.size()) + 1; QFile::exists(partPath(number)); ++number) {
+                if (!QFile::remove(partPath(number))) {
+                    qWarning() << "Could not remove the old part" << partPath(number);
+                    break;
+                }
+            }
+            qDebug() << "Saved" << shards.size() << "parts, listed in" << manifestPath;
+        }
+    }
 
     // Signal successful completion
     emit finished(result);
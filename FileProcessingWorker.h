@@ -1,36 +1,67 @@
 // FileProcessingWorker.h
 #pragma once
 
+#include <QBitArray>
+#include <QByteArray>
 #include <QObject>
+#include <QSharedPointer>
 #include <QString>
-#include <set>
+#include "ExportControl.h"
+#include "ExportRope.h"
+#include "ProcessingProgress.h"
+#include "ScanSnapshot.h"
 
-class FileSystemModelWithGitIgnore;
+class ContentCache;
 
 class FileProcessingWorker : public QObject {
     Q_OBJECT
 
 public:
     explicit FileProcessingWorker(
-        const QString& rootPath, 
-        const std::set<QString>& selectedFiles,
-        FileSystemModelWithGitIgnore* model,
+        const QSharedPointer<const ScanSnapshot>& snapshot,
+        const QBitArray& selectedFiles,
         QObject* parent = nullptr
     );
 
+    // Streams the output into path instead of handing it to finished(),
+    // which then carries an empty rope. path is replaced atomically once
+    // everything was written, and left alone on failure. With shard_max_mb
+    // set, path names the parts and their manifest instead. "-" streams to
+    // standard output, in one part.
+    void setOutputPath(const QString& path) { outputPath = path; }
+
+    // Reuses what earlier exports read from files that haven't changed, and
+    // keeps what this one reads for the next
+    void setContentCache(const QSharedPointer<ContentCache>& cache) { contentCache = cache; }
+
+    // Tokens filePath will add to an export: counted if the cache has it,
+    // estimated from its size otherwise
+    static qint64 estimateTokens(ContentCache* cache, const QString& filePath, const FileRecord& record);
+
+    // Counters for whoever shows the progress; updated without signals
+    QSharedPointer<const ProcessingProgress> progress() const { return progressCounters; }
+
+    // Cancels, pauses and resumes process() from any thread. A cancelled
+    // export emits cancelled() instead of finished() and saves nothing.
+    QSharedPointer<ExportControl> control() const { return exportControl; }
+
 public slots:
     void process();
 
 signals:
-    void processingProgress(int current, int total);
-    void currentFile(const QString& filePath);
-    void statistics(int processedFiles, qint64 totalSize);
-    void finished(const QString& result);
+    // The output as UTF-8 chunks; turning it into a QString is up to the
+    // receiver
+    void finished(const ExportRope& result);
     void error(const QString& message);
+    void cancelled();
 
 private:
-    QString rootPath;
-    std::set<QString> selectedFiles;
-    FileSystemModelWithGitIgnore* fileModel;
+    QSharedPointer<const ScanSnapshot> snapshot;
+    // One bit per snapshot node; only accepted files can be selected
+    QBitArray selectedFiles;
+    QString outputPath;
+    QSharedPointer<ContentCache> contentCache;
+    QSharedPointer<ProcessingProgress> progressCounters;
+    QSharedPointer<ExportControl> exportControl;
     qint64 totalProcessedSize;
 };
\ No newline at end of file
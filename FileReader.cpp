@@ -0,0 +1,522 @@
+#include "FileReader.h"
+#include "ContentHash.h"
+#include "ExportControl.h"
+#include "FileExtensionConfig.h"
+#include "Utf8Validator.h"
+#include <QDateTime>
+#include <QFile>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+
+// Between two checks of the export's control
+constexpr qsizetype kReadChunk = 1024 * 1024;
+constexpr qint64 kCopyChunk = 8 * 1024 * 1024;
+
+struct Signature {
+    const char* bytes;
+    qsizetype size;
+};
+
+// Formats whose header has no NUL byte early enough to give them away
+const Signature kSignatures[] = {
+    {"\x89PNG\r\n\x1a\n", 8},
+    {"GIF87a", 6},
+    {"GIF89a", 6},
+    {"\xFF\xD8\xFF", 3},            // JPEG
+    {"%PDF-", 5},
+    {"PK\x03\x04", 4},              // zip, jar, docx, ...
+    {"\x1F\x8B", 2},                // gzip
+    {"\x28\xB5\x2F\xFD", 4},        // zstd
+    {"\xFD" "7zXZ", 5},             // xz
+    {"7z\xBC\xAF\x27\x1C", 6},
+    {"\x7F" "ELF", 4},
+    {"\xCA\xFE\xBA\xBE", 4},        // Java class, Mach-O universal
+    {"\xCF\xFA\xED\xFE", 4},        // Mach-O 64
+    {"SQLite format 3", 15},
+};
+
+// Bytes below 0x20 that text files use
+constexpr std::array<bool, 256> makeControlTable() {
+    std::array<bool, 256> table = {};
+    for (int c = 0; c < 0x20; ++c) {
+        table[c] = c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != '\v' && c != 0x1B;
+    }
+    table[0x7F] = true;
+    return table;
+}
+constexpr std::array<bool, 256> kControl = makeControlTable();
+
+void normalizeLineEndings(QByteArray& content) {
+    if (content.contains('\r')) {
+        content.replace("\r\n", "\n");
+    }
+}
+
+inline bool isContinuation(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// size, less a UTF-8 sequence cut off at the end
+qsizetype completeUtf8(const char* data, qsizetype size) {
+    qsizetype lead = size;
+    while (lead > 0 && size - lead < 4 && isContinuation(data[lead - 1])) {
+        --lead;
+    }
+    if (lead == 0) {
+        return size;
+    }
+    const auto c = static_cast<unsigned char>(data[lead - 1]);
+    const qsizetype length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    return size - (lead - 1) >= length ? size : lead - 1;
+}
+
+} // namespace
+
+OpenedFile::~OpenedFile() {
+    close();
+}
+
+OpenedFile::OpenedFile(OpenedFile&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1)), m_size(other.m_size) {
+}
+
+OpenedFile& OpenedFile::operator=(OpenedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_fd = std::exchange(other.m_fd, -1);
+        m_size = other.m_size;
+    }
+    return *this;
+}
+
+void OpenedFile::close() {
+#ifdef Q_OS_UNIX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+    m_fd = -1;
+}
+
+bool OpenedFile::copyTo(QFileDevice& output, QString& errorString, const ExportControl* control) {
+#ifdef Q_OS_LINUX
+    // Whatever output still buffers goes first; the kernel appends at the
+    // descriptor's offset
+    if (!output.flush()) {
+        errorString = output.errorString();
+        return false;
+    }
+    const int outputFd = output.handle();
+
+    // copy_file_range() can share extents or copy inside the kernel; where
+    // it isn't supported (old kernels, some filesystem pairs) sendfile()
+    // still avoids user space
+    loff_t offset = 0;
+    bool useSendfile = false;
+    while (offset < m_size) {
+        if (control && !control->checkpoint()) {
+            errorString.clear();
+            close();
+            return false;
+        }
+        const size_t wanted = static_cast<size_t>(qMin<qint64>(m_size - offset, kCopyChunk));
+        ssize_t bytes;
+        if (!useSendfile) {
+            bytes = ::copy_file_range(m_fd, &offset, outputFd, nullptr, wanted, 0);
+            if (bytes < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useSendfile = true;
+                continue;
+            }
+        } else {
+            off_t sendOffset = offset;
+            bytes = ::sendfile(outputFd, m_fd, &sendOffset, wanted);
+            if (bytes > 0) {
+                offset = sendOffset;
+            }
+        }
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            errorString = qt_error_string(errno);
+            close();
+            return false;
+        }
+        if (bytes == 0) {
+            break;  // shrank since it was checked
+        }
+    }
+    close();
+
+    // Keep QFileDevice's idea of the position in step with the descriptor
+    if (!output.seek(output.pos() + offset)) {
+        errorString = output.errorString();
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(output);
+    Q_UNUSED(control);
+    errorString = QStringLiteral("Copying between files is not supported on this platform");
+    close();
+    return false;
+#endif
+}
+
+FileReader::FileReader(const ExportControl* control)
+    : m_control(control) {
+    const FileExtensionConfig& config = FileExtensionConfig::getInstance();
+    m_sniffBytes = config.getBinarySniffBytes();
+    m_maxControlPercent = config.getBinaryMaxControlPercent();
+    m_truncateAbove = config.getTruncateAboveKB() * 1024;
+    m_truncateKeep = config.getTruncateKeepKB() * 1024;
+}
+
+qint64 FileReader::exportedSize(qint64 size) {
+    const FileExtensionConfig& config = FileExtensionConfig::getInstance();
+    const qint64 above = config.getTruncateAboveKB() * 1024;
+    return above > 0 && size > above ? 2 * config.getTruncateKeepKB() * 1024 : size;
+}
+
+bool FileReader::looksBinary(const char* data, qsizetype size) const {
+    for (const Signature& signature : kSignatures) {
+        if (size >= signature.size && std::memcmp(data, signature.bytes, static_cast<size_t>(signature.size)) == 0) {
+            return true;
+        }
+    }
+    // memchr is vectorized by the C library; NUL never occurs in UTF-8 text
+    if (std::memchr(data, 0, static_cast<size_t>(size))) {
+        return true;
+    }
+
+    // Branch-free, so the compiler can unroll and vectorize it
+    qsizetype control = 0;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (qsizetype i = 0; i < size; ++i) {
+        control += kControl[bytes[i]];
+    }
+    return control * 100 > size * m_maxControlPercent;
+}
+
+bool FileReader::inspectInPlace(int fd, qint64 fileSize, QByteArray& content, OpenedFile& passThrough,
+                                ContentHash* hash, Result& result) const {
+#ifdef Q_OS_LINUX
+    // pread() leaves the offset alone, so a file that can't be mapped is
+    // still read from the start afterwards
+    if (m_sniffBytes > 0) {
+        QByteArray prefix(m_sniffBytes, Qt::Uninitialized);
+        ssize_t bytes;
+        do {
+            bytes = ::pread(fd, prefix.data(), static_cast<size_t>(prefix.size()), 0);
+        } while (bytes < 0 && errno == EINTR);
+        if (bytes < 0) {
+            return false;
+        }
+        if (looksBinary(prefix.constData(), bytes)) {
+            ::close(fd);
+            content = prefix.first(bytes);
+            result = Result::Binary;
+            return true;
+        }
+    }
+
+    // Mapping needs the size as it is now, not as it was during the scan.
+    // Like any mapping, this one faults if the file is truncated while it
+    // is being checked.
+    if (fileSize <= 0) {
+        return false;
+    }
+    const size_t size = static_cast<size_t>(fileSize);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    // Checking touches the page cache but copies nothing
+    const char* data = static_cast<const char*>(mapping);
+    const bool unchanged = !std::memchr(data, '\r', size) &&
+                           Utf8Validator::isValid(data, static_cast<qsizetype>(size));
+    if (hash) {
+        hash->update(data, static_cast<qsizetype>(size));
+    }
+    if (unchanged) {
+        ::munmap(mapping, size);
+        passThrough = OpenedFile(fd, static_cast<qint64>(size));
+        content.clear();
+    } else {
+        content = QByteArray(data, static_cast<qsizetype>(size));
+        ::munmap(mapping, size);
+        ::close(fd);
+        normalizeLineEndings(content);
+    }
+    result = Result::Read;
+    return true;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(fileSize);
+    Q_UNUSED(content);
+    Q_UNUSED(passThrough);
+    Q_UNUSED(hash);
+    Q_UNUSED(result);
+    return false;
+#endif
+}
+
+FileReader::Result FileReader::read(const QString& filePath, const FileRecord& record,
+                                    QByteArray& content, QString& errorString,
+                                    OpenedFile* passThrough, ContentHash* hash,
+                                    bool* truncated, FileRecord* opened,
+                                    const CacheLookup& isCached) const {
+    if (truncated) {
+        *truncated = false;
+    }
+    if (opened) {
+        opened->size = -1;
+    }
+#ifdef Q_OS_UNIX
+    // QFile::open() fstat()s every file it opens; a plain open() does not
+    int fd = ::open(QFile::encodeName(filePath).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        errorString = qt_error_string(errno);
+        return Result::Failed;
+    }
+
+    // Whether the file is cut, where its tail starts, how much is mapped and
+    // whether the cache still holds it all go by the file as opened, which
+    // the scan's record may no longer match. One fstat() answers them all.
+    qint64 size = record.size;
+    struct stat status;
+    if ((m_truncateAbove > 0 || passThrough || opened) && ::fstat(fd, &status) == 0) {
+        size = status.st_size;
+        if (opened) {
+            opened->size = status.st_size;
+            // In the units ParallelTreeWalker::statEntry() records
+#ifdef Q_OS_LINUX
+            opened->mtime = qint64(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#elif defined(Q_OS_DARWIN)
+            opened->mtime = (qint64(status.st_mtimespec.tv_sec) * 1000 + status.st_mtimespec.tv_nsec / 1000000) * 1000000;
+#else
+            opened->mtime = qint64(status.st_mtime) * 1000000000;
+#endif
+            opened->inode = status.st_ino;
+            if (isCached && isCached(*opened)) {
+                ::close(fd);
+                return Result::Cached;
+            }
+        }
+    } else if (passThrough) {
+        // Without a size the file can't be mapped
+        passThrough = nullptr;
+    }
+    if (truncates(size)) {
+        // pread() leaves the offset alone, and the middle is never read
+        const Result result = readEnds(size,
+            [fd](qint64 offset, char* data, qint64 size, QString& readError) {
+                qint64 done = 0;
+                while (done < size) {
+                    const ssize_t bytes = ::pread(fd, data + done, static_cast<size_t>(size - done),
+                                                  static_cast<off_t>(offset + done));
+                    if (bytes < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        readError = qt_error_string(errno);
+                        return qint64(-1);
+                    }
+                    if (bytes == 0) {
+                        break;
+                    }
+                    done += bytes;
+                }
+                return done;
+            }, content, errorString, truncated);
+        ::close(fd);
+        return result;
+    }
+
+    Result inspected = Result::Failed;
+    if (passThrough && inspectInPlace(fd, size, content, *passThrough, hash, inspected)) {
+        return inspected;
+    }
+
+    // One byte of slack, so the read that hits end of file needs no resize
+    content.resize(qMax<qint64>(record.size, 0) + 1);
+    qsizetype used = 0;
+    bool sniffed = m_sniffBytes == 0;
+    for (;;) {
+        if (used == content.size()) {
+            content.resize(content.size() * 2);
+        }
+        if (m_control && !m_control->checkpoint()) {
+            ::close(fd);
+            return Result::Cancelled;
+        }
+        // Nothing past the sniffed prefix is read before it has been checked
+        qsizetype wanted = qMin(content.size() - used, kReadChunk);
+        if (!sniffed) {
+            wanted = qMin(wanted, m_sniffBytes - used);
+        }
+        ssize_t bytes = ::read(fd, content.data() + used, static_cast<size_t>(wanted));
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            errorString = qt_error_string(errno);
+            ::close(fd);
+            return Result::Failed;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        // While the bytes are still in cache
+        if (hash) {
+            hash->update(content.constData() + used, bytes);
+        }
+        used += bytes;
+
+        if (!sniffed && used >= m_sniffBytes) {
+            sniffed = true;
+            if (looksBinary(content.constData(), used)) {
+                ::close(fd);
+                content.truncate(used);
+                return Result::Binary;
+            }
+        }
+    }
+    ::close(fd);
+    content.truncate(used);
+#else
+    Q_UNUSED(passThrough);
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString = file.errorString();
+        return Result::Failed;
+    }
+    if (opened) {
+        // As ParallelTreeWalker::statEntry() records it here
+        opened->size = file.size();
+        opened->mtime = file.fileTime(QFileDevice::FileModificationTime).toMSecsSinceEpoch() * 1000000;
+        opened->inode = 0;
+        if (isCached && isCached(*opened)) {
+            return Result::Cached;
+        }
+    }
+    const qint64 size = m_truncateAbove > 0 ? file.size() : record.size;
+    if (truncates(size)) {
+        return readEnds(size,
+            [&file](qint64 offset, char* data, qint64 size, QString& readError) {
+                const qint64 bytes = file.seek(offset) ? file.read(data, size) : -1;
+                if (bytes < 0) {
+                    readError = file.errorString();
+                }
+                return bytes;
+            }, content, errorString, truncated);
+    }
+    content = file.read(m_sniffBytes);
+    bool sniffed = m_sniffBytes == 0;
+    if (!sniffed && content.size() == m_sniffBytes) {
+        sniffed = true;
+        if (looksBinary(content.constData(), content.size())) {
+            return Result::Binary;
+        }
+    }
+    while (!file.atEnd()) {
+        if (m_control && !m_control->checkpoint()) {
+            return Result::Cancelled;
+        }
+        const QByteArray chunk = file.read(kReadChunk);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        content += chunk;
+    }
+    if (hash) {
+        hash->update(content.constData(), content.size());
+    }
+#endif
+
+    // Files shorter than the sniffed prefix are checked whole
+    if (!sniffed && looksBinary(content.constData(), content.size())) {
+        return Result::Binary;
+    }
+    normalizeLineEndings(content);
+    return Result::Read;
+}
+
+FileReader::Result FileReader::readEnds(qint64 size, const ReadAt& readAt, QByteArray& content,
+                                        QString& errorString, bool* truncated) const {
+    QByteArray head(m_truncateKeep, Qt::Uninitialized);
+    const qint64 headBytes = readAt(0, head.data(), head.size(), errorString);
+    if (headBytes < 0) {
+        return Result::Failed;
+    }
+    head.truncate(headBytes);
+    const qsizetype sniffed = qMin<qsizetype>(head.size(), m_sniffBytes);
+    if (sniffed > 0 && looksBinary(head.constData(), sniffed)) {
+        content = head.first(sniffed);
+        return Result::Binary;
+    }
+
+    // A file that shrank since it was measured has less of a tail
+    const qint64 tailStart = qMax(size - m_truncateKeep, headBytes);
+    QByteArray tail(m_truncateKeep, Qt::Uninitialized);
+    const qint64 tailBytes = readAt(tailStart, tail.data(), tail.size(), errorString);
+    if (tailBytes < 0) {
+        return Result::Failed;
+    }
+    tail.truncate(tailBytes);
+    if (tailStart == headBytes) {
+        content = head + tail;
+        normalizeLineEndings(content);
+        return Result::Read;
+    }
+
+    // Cut at line ends, so that no line and no UTF-8 sequence is split
+    qsizetype headEnd = head.lastIndexOf('\n') + 1;
+    if (headEnd == 0) {
+        headEnd = completeUtf8(head.constData(), head.size());
+    }
+    qsizetype tailBegin = tail.indexOf('\n') + 1;
+    if (tailBegin == 0 || tailBegin == tail.size()) {
+        tailBegin = 0;
+        while (tailBegin < tail.size() && tailBegin < 3 && isContinuation(tail[tailBegin])) {
+            ++tailBegin;
+        }
+    }
+
+    // Only the ends are read, so lines left out are estimated from them
+    const qint64 omittedBytes = tailStart + tailBegin - headEnd;
+    const qint64 keptBytes = headEnd + tail.size() - tailBegin;
+    const qint64 keptLines = std::count(head.cbegin(), head.cbegin() + headEnd, '\n') +
+                             std::count(tail.cbegin() + tailBegin, tail.cend(), '\n');
+    const qint64 omittedLines = keptBytes > 0 ? omittedBytes * keptLines / keptBytes : 0;
+
+    content = head.first(headEnd);
+    if (!content.isEmpty() && !content.endsWith('\n')) {
+        content += '\n';
+    }
+    content += "[... " + QByteArray::number(omittedBytes) + " bytes (about " +
+               QByteArray::number(omittedLines) + " lines) left out ...]\n";
+    content += tail.sliced(tailBegin);
+    normalizeLineEndings(content);
+    if (truncated) {
+        *truncated = true;
+    }
+    return Result::Read;
+}
@@ -0,0 +1,115 @@
+// FileReader.h
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+#include "ScanSnapshot.h"
+
+class ContentHash;
+class ExportControl;
+class QFileDevice;
+
+// A file whose bytes go to the output unchanged, kept open so the kernel
+// can copy them there without passing through user space
+class OpenedFile {
+public:
+    OpenedFile() = default;
+    OpenedFile(int fd, qint64 size) : m_fd(fd), m_size(size) {}
+    ~OpenedFile();
+    OpenedFile(OpenedFile&& other) noexcept;
+    OpenedFile& operator=(OpenedFile&& other) noexcept;
+    OpenedFile(const OpenedFile&) = delete;
+    OpenedFile& operator=(const OpenedFile&) = delete;
+
+    bool isOpen() const { return m_fd >= 0; }
+    qint64 size() const { return m_size; }
+
+    // Appends the file to output at its current position, then closes it.
+    // Fails with an empty errorString when control cancels the export.
+    bool copyTo(QFileDevice& output, QString& errorString, const ExportControl* control = nullptr);
+
+private:
+    void close();
+
+    int m_fd = -1;
+    qint64 m_size = 0;
+};
+
+// Reads selected files for the export.
+//
+// Files are read by what the scan recorded about them, and no path is
+// stat()ed again: on network and FUSE mounts every stat is a round trip.
+// Each file costs one open() and, when its current size or identity is
+// needed (mapping it, cutting it, checking the content cache), one fstat()
+// of the open descriptor, which is answered from what open() fetched.
+// Otherwise the recorded size sizes the buffer; reading goes on until end
+// of file, so a file that grew since the scan is still read completely.
+//
+// The first binary_sniff_bytes of every file are checked for binary content
+// before the rest is read; binary files stop there.
+//
+// On Linux, files headed for an output file can skip user space: they are
+// mapped and checked in place, and when their bytes need no change (valid
+// UTF-8 without \r\n) they are handed back open, for copy_file_range().
+//
+// Large files are read in chunks, with the export's control checked in
+// between, so a cancelled or paused export stops mid-file.
+//
+// With truncate_above_kb set, files above it are exported as their first
+// and last truncate_keep_kb, cut at line ends, around a line saying how much
+// was left out. Only those two ranges are read. Whether a file is cut goes
+// by the size of the opened file, which the scan's may no longer match.
+class FileReader {
+public:
+    enum class Result {
+        Read,
+        Binary,     // content holds the bytes that were sniffed
+        Failed,
+        Cancelled,
+        Cached      // isCached took the file; nothing was read
+    };
+
+    // Asked about the file as the opened descriptor describes it
+    using CacheLookup = std::function<bool(const FileRecord& opened)>;
+
+    explicit FileReader(const ExportControl* control = nullptr);
+
+    // Contents of filePath with \r\n turned into \n, as text mode reads did.
+    // With passThrough, a file that can be copied as it is comes back as
+    // Read with empty content and passThrough open. With hash, the file's
+    // bytes as stored are fed into it while they are read. truncated is set
+    // when content holds only the file's two ends. With opened, the file's
+    // size, mtime and inode as opened are stored there (size -1 if unknown);
+    // with isCached as well, it is asked about them before anything is read.
+    Result read(const QString& filePath, const FileRecord& record,
+                QByteArray& content, QString& errorString,
+                OpenedFile* passThrough = nullptr, ContentHash* hash = nullptr,
+                bool* truncated = nullptr, FileRecord* opened = nullptr,
+                const CacheLookup& isCached = nullptr) const;
+
+    // Known binary signature, a NUL byte, or too many control characters
+    bool looksBinary(const char* data, qsizetype size) const;
+
+    // Whether a file of this size is exported as its two ends only
+    bool truncates(qint64 size) const { return m_truncateAbove > 0 && size > m_truncateAbove; }
+    // Bytes an export reads of a file of this size, at most
+    static qint64 exportedSize(qint64 size);
+
+private:
+    // Reads up to size bytes at offset; -1 with errorString on failure
+    using ReadAt = std::function<qint64(qint64 offset, char* data, qint64 size, QString& errorString)>;
+    Result readEnds(qint64 size, const ReadAt& readAt, QByteArray& content,
+                    QString& errorString, bool* truncated) const;
+
+    // false when the file can't be mapped and has to be read instead; size
+    // is the opened file's
+    bool inspectInPlace(int fd, qint64 size, QByteArray& content, OpenedFile& passThrough,
+                        ContentHash* hash, Result& result) const;
+
+    const ExportControl* m_control;
+    qsizetype m_sniffBytes;
+    int m_maxControlPercent;
+    qint64 m_truncateAbove;
+    qint64 m_truncateKeep;
+};
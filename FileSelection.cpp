@@ -0,0 +1,183 @@
+#include "FileSelection.h"
+#include "ScanSnapshot.h"
+
+void FileSelection::reset(const ScanSnapshot* snapshot, bool selectAll) {
+    m_snapshot = snapshot;
+    m_bits = QBitArray();
+    m_total.clear();
+    m_selected.clear();
+    m_choice.clear();
+    if (!snapshot || snapshot->isEmpty()) {
+        return;
+    }
+    grow();
+
+    // Children always have larger ids than their parent, so one pass from
+    // the back sums every subtree
+    for (int node = snapshot->nodeCount() - 1; node > 0; --node) {
+        if (snapshot->flags(node) & ScanSnapshot::Removed) {
+            continue;
+        }
+        if (!snapshot->isDirectory(node) && snapshot->isAccepted(node)) {
+            m_total[node] = 1;
+            m_selected[node] = selectAll ? 1 : 0;
+            m_bits.setBit(node, selectAll);
+        }
+        const int parent = snapshot->parent(node);
+        m_total[parent] += m_total[node];
+        m_selected[parent] += m_selected[node];
+    }
+}
+
+void FileSelection::grow() {
+    const int count = m_snapshot->nodeCount();
+    if (count <= static_cast<int>(m_total.size())) {
+        return;
+    }
+    m_bits.resize(count);
+    m_total.resize(count, 0);
+    m_selected.resize(count, 0);
+    m_choice.resize(count, -1);
+}
+
+int FileSelection::inheritedChoice(int node) const {
+    int choice = -1;
+    for (int current = m_snapshot->parent(node); current >= 0; current = m_snapshot->parent(current)) {
+        if (m_choice[current] >= 0) {
+            choice = m_choice[current];
+        }
+    }
+    return choice;
+}
+
+bool FileSelection::isSelected(int file) const {
+    if (!isSelectable(file)) {
+        return false;
+    }
+    const int choice = inheritedChoice(file);
+    return choice >= 0 ? choice == 1 : m_bits.testBit(file);
+}
+
+FileSelection::State FileSelection::state(int node) const {
+    if (!isSelectable(node)) {
+        return State::None;
+    }
+    const int choice = inheritedChoice(node);
+    if (choice >= 0) {
+        return choice == 1 ? State::All : State::None;
+    }
+    if (m_selected[node] == 0) {
+        return State::None;
+    }
+    return m_selected[node] == m_total[node] ? State::All : State::Partial;
+}
+
+void FileSelection::pushDown(int directory) {
+    const qint8 choice = m_choice[directory];
+    if (choice < 0) {
+        return;
+    }
+    const int count = m_snapshot->childCount(directory);
+    for (int row = 0; row < count; ++row) {
+        const int child = m_snapshot->child(directory, row);
+        m_selected[child] = choice == 1 ? m_total[child] : 0;
+        if (m_snapshot->isDirectory(child)) {
+            m_choice[child] = choice;
+        } else {
+            m_bits.setBit(child, choice == 1 && m_total[child] > 0);
+        }
+    }
+    m_choice[directory] = -1;
+}
+
+void FileSelection::pushPath(int node) {
+    std::vector<int> ancestors;
+    for (int current = m_snapshot->parent(node); current >= 0; current = m_snapshot->parent(current)) {
+        ancestors.push_back(current);
+    }
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+        pushDown(*it);
+    }
+}
+
+void FileSelection::setSelected(int node, bool selected) {
+    if (!isSelectable(node)) {
+        return;
+    }
+    pushPath(node);
+
+    const int delta = (selected ? m_total[node] : 0) - m_selected[node];
+    m_selected[node] += delta;
+    if (m_snapshot->isDirectory(node)) {
+        m_choice[node] = selected ? 1 : 0;
+    } else {
+        m_bits.setBit(node, selected);
+    }
+    for (int current = m_snapshot->parent(node); current >= 0; current = m_snapshot->parent(current)) {
+        m_selected[current] += delta;
+    }
+}
+
+void FileSelection::addFile(int file, bool selected) {
+    grow();
+    if (m_total[file] > 0) {
+        return;
+    }
+    pushPath(file);
+
+    m_total[file] = 1;
+    m_selected[file] = selected ? 1 : 0;
+    m_bits.setBit(file, selected);
+    for (int current = m_snapshot->parent(file); current >= 0; current = m_snapshot->parent(current)) {
+        m_total[current] += 1;
+        m_selected[current] += m_selected[file];
+    }
+}
+
+void FileSelection::removeFile(int file) {
+    if (!isSelectable(file)) {
+        return;
+    }
+    // The file may already be out of the tree, so nothing is pushed down.
+    // Counts below a pending choice are stale anyway and get rewritten from
+    // the totals when it is pushed.
+    const int wasSelected = isSelected(file) ? 1 : 0;
+    m_total[file] = 0;
+    m_selected[file] = 0;
+    m_bits.clearBit(file);
+    for (int current = m_snapshot->parent(file); current >= 0; current = m_snapshot->parent(current)) {
+        m_total[current] -= 1;
+        m_selected[current] -= wasSelected;
+    }
+}
+
+QBitArray FileSelection::files() const {
+    QBitArray result(static_cast<qsizetype>(m_total.size()));
+    if (m_total.empty()) {
+        return result;
+    }
+
+    // Depth first from the root, carrying the choice of the highest
+    // directory that has one
+    std::vector<std::pair<int, qint8>> stack;
+    stack.emplace_back(0, qint8(-1));
+    while (!stack.empty()) {
+        const auto [directory, inherited] = stack.back();
+        stack.pop_back();
+        const qint8 choice = inherited >= 0 ? inherited : m_choice[directory];
+
+        const int count = m_snapshot->childCount(directory);
+        for (int row = 0; row < count; ++row) {
+            const int child = m_snapshot->child(directory, row);
+            if (m_total[child] == 0) {
+                continue;
+            }
+            if (m_snapshot->isDirectory(child)) {
+                stack.emplace_back(child, choice);
+            } else if (choice >= 0 ? choice == 1 : m_bits.testBit(child)) {
+                result.setBit(child);
+            }
+        }
+    }
+    return result;
+}
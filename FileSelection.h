@@ -0,0 +1,54 @@
+// FileSelection.h
+#pragma once
+
+#include <QBitArray>
+#include <vector>
+
+class ScanSnapshot;
+
+// Which files of a ScanSnapshot are selected for export.
+//
+// Only files the filter accepted can be selected. Every node keeps how many
+// selectable files it covers and how many of those are selected, so the
+// check state of a directory and the size of the selection are O(1).
+// Checking or unchecking a directory is recorded on the directory itself and
+// costs O(depth); the choice is pushed down to its children only when
+// something below it changes, or when files() materializes the selection.
+class FileSelection {
+public:
+    enum class State : quint8 { None, Partial, All };
+
+    // Starts over for snapshot, with every selectable file selected or not
+    void reset(const ScanSnapshot* snapshot, bool selectAll);
+
+    int selectedCount() const { return m_selected.empty() ? 0 : m_selected[0]; }
+    int selectableCount() const { return m_total.empty() ? 0 : m_total[0]; }
+    bool isSelectable(int node) const { return node < static_cast<int>(m_total.size()) && m_total[node] > 0; }
+    bool isSelected(int file) const;
+    State state(int node) const;
+
+    // Selects or deselects a file, or every selectable file below a directory
+    void setSelected(int node, bool selected);
+
+    // Incremental updates: a file became selectable (new, or now accepted)
+    // or stopped being so (removed, or now rejected)
+    void addFile(int file, bool selected);
+    void removeFile(int file);
+
+    // One bit per node, set for the selected files
+    QBitArray files() const;
+
+private:
+    void grow();
+    // Applies the pending choices of every ancestor of node, top down
+    void pushPath(int node);
+    void pushDown(int directory);
+    // Value recorded on the highest ancestor of node, or -1
+    int inheritedChoice(int node) const;
+
+    const ScanSnapshot* m_snapshot = nullptr;
+    QBitArray m_bits;                 // explicit state of files
+    std::vector<qint32> m_total;      // selectable files covered
+    std::vector<qint32> m_selected;   // of which selected; stale below a pending choice
+    std::vector<qint8> m_choice;      // -1, or the 0/1 last set on a whole directory
+};
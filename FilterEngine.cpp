@@ -0,0 +1,120 @@
+#include "FilterEngine.h"
+#include "FileExtensionConfig.h"
+#include <limits>
+
+FilterEngine::FilterEngine(const QString& rootPath)
+    : m_rootPath(rootPath) {
+    const FileExtensionConfig& config = FileExtensionConfig::getInstance();
+
+    for (const QString& extension : config.getAllowedExtensions()) {
+        m_extensions.insert(extension.toLower());
+    }
+    for (const QString& directory : config.getExcludedDirectories()) {
+        m_excludedDirectories.insert(directory.toLower());
+    }
+    // Files that are truncated cost the same to export whatever their size
+    m_maxFileSize = config.getTruncateAboveKB() > 0 ? std::numeric_limits<qint64>::max()
+                                                   : config.getMaxFileSizeMB() * 1024 * 1024;
+
+    // Excluded directories are matched by name above, so the ignore stack
+    // only carries the project's own rules
+    m_rootStack = GitIgnoreStack::forRoot(rootPath, QStringList());
+}
+
+bool FilterEngine::hasAllowedExtension(QStringView fileName) const {
+    qsizetype dot = fileName.lastIndexOf('.');
+    if (dot != -1 && m_extensions.contains(fileName.mid(dot + 1).toString().toLower())) {
+        return true;
+    }
+    // Entries such as "makefile", "dockerfile" or "pom.xml" name whole files
+    return m_extensions.contains(fileName.toString().toLower());
+}
+
+GitIgnoreStack FilterEngine::ignoreStackFor(QStringView relativeDir) const {
+    QString key = relativeDir.toString();
+    {
+        QMutexLocker locker(&m_stackMutex);
+        auto it = m_directoryStacks.constFind(key);
+        if (it != m_directoryStacks.constEnd()) {
+            return *it;
+        }
+    }
+
+    qsizetype slash = relativeDir.lastIndexOf('/');
+    GitIgnoreStack parent = slash == -1 ? m_rootStack : ignoreStackFor(relativeDir.left(slash));
+    GitIgnoreStack stack = parent.enterDirectory(key);
+
+    QMutexLocker locker(&m_stackMutex);
+    m_directoryStacks.insert(key, stack);
+    return stack;
+}
+
+FilterEngine::Verdict FilterEngine::checkDirectory(QStringView relativePath,
+                                                   const GitIgnoreStack& stack) const {
+    QStringView name = relativePath.mid(relativePath.lastIndexOf('/') + 1);
+    if (m_excludedDirectories.contains(name.toString().toLower())) {
+        return Verdict::ExcludedDirectory;
+    }
+    if (stack.isDirectoryIgnored(relativePath)) {
+        return Verdict::IgnoredByPattern;
+    }
+    return Verdict::Accepted;
+}
+
+FilterEngine::Verdict FilterEngine::checkFileName(QStringView relativePath,
+                                                  const GitIgnoreStack& stack) const {
+    QStringView name = relativePath.mid(relativePath.lastIndexOf('/') + 1);
+    if (!hasAllowedExtension(name)) {
+        return Verdict::UnsupportedExtension;
+    }
+    if (stack.isIgnored(relativePath, false)) {
+        return Verdict::IgnoredByPattern;
+    }
+    return Verdict::Accepted;
+}
+
+FilterEngine::Verdict FilterEngine::checkFileSize(qint64 size) const {
+    return size > m_maxFileSize ? Verdict::TooLarge : Verdict::Accepted;
+}
+
+FilterEngine::Verdict FilterEngine::checkAncestors(QStringView relativeDir, GitIgnoreStack& stack) const {
+    stack = m_rootStack;
+    if (relativeDir.isEmpty()) {
+        return Verdict::Accepted;
+    }
+
+    qsizetype start = 0;
+    for (;;) {
+        qsizetype slash = relativeDir.indexOf('/', start);
+        QStringView directory = slash == -1 ? relativeDir : relativeDir.left(slash);
+
+        Verdict verdict = checkDirectory(directory, stack);
+        if (verdict != Verdict::Accepted) {
+            return verdict;
+        }
+        stack = ignoreStackFor(directory);
+
+        if (slash == -1) {
+            return Verdict::Accepted;
+        }
+        start = slash + 1;
+    }
+}
+
+QString FilterEngine::verdictDescription(Verdict verdict) {
+    switch (verdict) {
+    case Verdict::Accepted:
+        return "accepted";
+    case Verdict::ExcludedDirectory:
+        return "in an excluded directory";
+    case Verdict::IgnoredByPattern:
+        return "ignored by pattern";
+    case Verdict::UnsupportedExtension:
+        return "extension not allowed";
+    case Verdict::TooLarge:
+        return "file too large";
+    case Verdict::NotReadable:
+        return "not a readable file";
+    }
+    return QString();
+}
@@ -0,0 +1,60 @@
+// FilterEngine.h
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include "GitIgnoreStack.h"
+
+// The single answer to "should this path be exported".
+//
+// Built once per project root from FileExtensionConfig and the project's
+// ignore files, then shared (read-only) by the tree walker, the main window
+// and the model. Checks run cheapest first: extension and excluded directory
+// names are hash lookups, ignore rules come next and the file size, the only
+// check that touches the filesystem, comes last.
+class FilterEngine {
+public:
+    enum class Verdict : quint8 {
+        Accepted,
+        ExcludedDirectory,      // inside one of the configured excluded_directories
+        IgnoredByPattern,       // .gitignore, .git/info/exclude
+        UnsupportedExtension,
+        TooLarge,
+        NotReadable             // missing, not a regular file or no permission
+    };
+
+    explicit FilterEngine(const QString& rootPath);
+
+    const QString& rootPath() const { return m_rootPath; }
+    const GitIgnoreStack& rootIgnoreStack() const { return m_rootStack; }
+    qint64 maxFileSize() const { return m_maxFileSize; }
+
+    // Steps for walkers that keep their own GitIgnoreStack per directory.
+    // Paths are relative to the root; none of these touch the filesystem.
+    Verdict checkDirectory(QStringView relativePath, const GitIgnoreStack& stack) const;
+    Verdict checkFileName(QStringView relativePath, const GitIgnoreStack& stack) const;
+    Verdict checkFileSize(qint64 size) const;
+    // Checks every directory of relativeDir from the root down, leaving the
+    // stack of the innermost one in stack
+    Verdict checkAncestors(QStringView relativeDir, GitIgnoreStack& stack) const;
+
+    static QString verdictDescription(Verdict verdict);
+
+private:
+    bool hasAllowedExtension(QStringView fileName) const;
+    GitIgnoreStack ignoreStackFor(QStringView relativeDir) const;
+
+    QString m_rootPath;
+    GitIgnoreStack m_rootStack;
+    QSet<QString> m_extensions;          // lower case, without the dot
+    QSet<QString> m_excludedDirectories; // lower case, like the patterns they replace
+    qint64 m_maxFileSize;
+
+    // Stacks of directories reached through checkAncestors(), keyed by relative path
+    mutable QMutex m_stackMutex;
+    mutable QHash<QString, GitIgnoreStack> m_directoryStacks;
+};
@@ -0,0 +1,245 @@
+#include "GitIgnoreMatcher.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kHashSeed = 1469598103934665603ull;
+constexpr size_t kHashPrime = 1099511628211ull;
+
+bool hasWildcard(QStringView pattern) {
+    for (QChar c : pattern) {
+        if (c == '*' || c == '?' || c == '[' || c == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Translate one gitignore glob into a regular expression. Unlike
+// QRegularExpression::wildcardToRegularExpression this understands "**".
+QString globToRegex(const QString& glob) {
+    QString rx;
+    const qsizetype length = glob.size();
+
+    for (qsizetype i = 0; i < length; ++i) {
+        QChar c = glob[i];
+
+        if (c == '*') {
+            bool doubleStar = i + 1 < length && glob[i + 1] == '*';
+            bool atSegmentStart = i == 0 || glob[i - 1] == '/';
+            if (doubleStar && atSegmentStart && i + 2 == length) {
+                rx += ".*";
+                break;
+            }
+            if (doubleStar && atSegmentStart && glob[i + 2] == '/') {
+                rx += "(?:.*/)?";
+                i += 2;
+                continue;
+            }
+            rx += "[^/]*";
+            if (doubleStar) {
+                ++i;
+            }
+        } else if (c == '?') {
+            rx += "[^/]";
+        } else if (c == '[') {
+            qsizetype j = i + 1;
+            if (j < length && (glob[j] == '!' || glob[j] == '^')) {
+                ++j;
+            }
+            if (j < length && glob[j] == ']') {
+                ++j;
+            }
+            while (j < length && glob[j] != ']') {
+                ++j;
+            }
+            if (j >= length) {
+                rx += "\\[";
+                continue;
+            }
+
+            rx += '[';
+            qsizetype k = i + 1;
+            if (glob[k] == '!' || glob[k] == '^') {
+                rx += '^';
+                ++k;
+            }
+            for (; k < j; ++k) {
+                if (glob[k] == '\\' || glob[k] == '[' || glob[k] == ']') {
+                    rx += '\\';
+                }
+                rx += glob[k];
+            }
+            rx += ']';
+            i = j;
+        } else if (c == '\\' && i + 1 < length) {
+            rx += QRegularExpression::escape(glob.mid(++i, 1));
+        } else {
+            rx += QRegularExpression::escape(QString(c));
+        }
+    }
+    return rx;
+}
+
+} // namespace
+
+GitIgnoreMatcher::GitIgnoreMatcher(const QStringList& patterns) {
+    addPatterns(patterns);
+}
+
+void GitIgnoreMatcher::addPatterns(const QStringList& patterns) {
+    for (const QString& pattern : patterns) {
+        addPattern(pattern);
+    }
+    compileGlobs();
+}
+
+void GitIgnoreMatcher::addPattern(QString pattern) {
+    pattern = pattern.trimmed();
+    if (pattern.isEmpty() || pattern.startsWith('#')) {
+        return;
+    }
+
+    bool negated = false;
+    if (pattern.startsWith('!')) {
+        negated = true;
+        pattern.remove(0, 1);
+    }
+
+    bool dirOnly = false;
+    while (pattern.endsWith('/')) {
+        pattern.chop(1);
+        dirOnly = true;
+    }
+    // "**/name" is the same as an unanchored "name"
+    if (pattern.startsWith("**/") && !pattern.mid(3).contains('/')) {
+        pattern.remove(0, 3);
+    }
+
+    bool anchored = pattern.contains('/');
+    if (pattern.startsWith('/')) {
+        pattern.remove(0, 1);
+    }
+    if (pattern.isEmpty()) {
+        return;
+    }
+
+    const int index = m_negated.size();
+    m_negated.append(negated);
+
+    if (!anchored) {
+        if (!hasWildcard(pattern)) {
+            m_names[foldedHash(pattern)].append({pattern, index, dirOnly});
+        } else if (pattern.startsWith("*.") && !hasWildcard(QStringView(pattern).mid(2))) {
+            QString extension = pattern.mid(2);
+            m_extensions[foldedHash(extension)].append({extension, index, dirOnly});
+        } else {
+            GlobSet& globs = dirOnly ? m_dirNameGlobs : m_nameGlobs;
+            globs.regexes.append(globToRegex(pattern));
+            globs.indexes.append(index);
+        }
+    } else if (!hasWildcard(pattern)) {
+        m_paths[foldedHash(pattern)].append({pattern, index, dirOnly});
+    } else {
+        GlobSet& globs = dirOnly ? m_dirPathGlobs : m_pathGlobs;
+        globs.regexes.append(globToRegex(pattern));
+        globs.indexes.append(index);
+    }
+}
+
+void GitIgnoreMatcher::compileGlobs() {
+    m_nameGlobs.compile();
+    m_dirNameGlobs.compile();
+    m_pathGlobs.compile();
+    m_dirPathGlobs.compile();
+}
+
+void GitIgnoreMatcher::GlobSet::compile() {
+    if (indexes.isEmpty()) {
+        rx = QRegularExpression();
+        return;
+    }
+
+    // Later patterns take precedence, and an anchored alternation stops at
+    // the first branch that matches, so list the branches newest first and
+    // give each its own group to recover which one it was.
+    QStringList branches;
+    branches.reserve(regexes.size());
+    for (qsizetype i = regexes.size() - 1; i >= 0; --i) {
+        branches.append('(' + regexes[i] + ')');
+    }
+
+    rx = QRegularExpression("\\A(?:" + branches.join('|') + ")\\z",
+                            QRegularExpression::CaseInsensitiveOption);
+    rx.optimize();
+}
+
+int GitIgnoreMatcher::GlobSet::match(QStringView subject) const {
+    if (indexes.isEmpty()) {
+        return -1;
+    }
+    QRegularExpressionMatch m = rx.matchView(subject);
+    if (!m.hasMatch()) {
+        return -1;
+    }
+    return indexes[indexes.size() - m.lastCapturedIndex()];
+}
+
+size_t GitIgnoreMatcher::foldedHash(QStringView text) {
+    size_t hash = kHashSeed;
+    for (QChar c : text) {
+        hash = (hash ^ c.toCaseFolded().unicode()) * kHashPrime;
+    }
+    return hash;
+}
+
+int GitIgnoreMatcher::lookupLiteral(const LiteralTable& table, QStringView text, bool isDir) {
+    auto it = table.constFind(foldedHash(text));
+    if (it == table.constEnd()) {
+        return -1;
+    }
+    int best = -1;
+    for (const LiteralRule& rule : *it) {
+        if ((isDir || !rule.dirOnly) && rule.index > best &&
+            text.compare(QStringView(rule.text), Qt::CaseInsensitive) == 0) {
+            best = rule.index;
+        }
+    }
+    return best;
+}
+
+GitIgnoreMatcher::Result GitIgnoreMatcher::match(QStringView relativePath, bool isDir) const {
+    if (m_negated.isEmpty() || relativePath.isEmpty()) {
+        return Result::NoMatch;
+    }
+
+    QStringView name = relativePath.mid(relativePath.lastIndexOf('/') + 1);
+    int best = lookupLiteral(m_names, name, isDir);
+    best = std::max(best, lookupLiteral(m_paths, relativePath, isDir));
+
+    if (!m_extensions.isEmpty()) {
+        // Try every suffix after a dot so that "*.tar.gz" matches "a.tar.gz"
+        for (qsizetype dot = name.indexOf('.'); dot != -1; dot = name.indexOf('.', dot + 1)) {
+            best = std::max(best, lookupLiteral(m_extensions, name.mid(dot + 1), isDir));
+        }
+    }
+
+    // Globs only need to run if one of them could beat what we already have
+    auto consider = [&best](const GlobSet& globs, QStringView subject) {
+        if (!globs.isEmpty() && globs.indexes.last() > best) {
+            best = std::max(best, globs.match(subject));
+        }
+    };
+    consider(m_nameGlobs, name);
+    consider(m_pathGlobs, relativePath);
+    if (isDir) {
+        consider(m_dirNameGlobs, name);
+        consider(m_dirPathGlobs, relativePath);
+    }
+
+    if (best < 0) {
+        return Result::NoMatch;
+    }
+    return m_negated[best] ? Result::Included : Result::Ignored;
+}
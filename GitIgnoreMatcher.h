@@ -0,0 +1,76 @@
+// GitIgnoreMatcher.h
+#pragma once
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+// Compiled form of the patterns of a single ignore file.
+//
+// Patterns are classified once, when the matcher is built, so answering a
+// query never compiles a regular expression:
+//  - literal names ("build", "Thumbs.db") and "*.ext" patterns are hash
+//    lookups on the last path component,
+//  - literal paths containing a slash ("docs/out", "/TODO") are hash lookups
+//    on the whole relative path,
+//  - everything else is folded into one precompiled alternation per kind.
+// Git semantics are kept: the last matching pattern wins, "!" re-includes,
+// a trailing "/" only matches directories and "**" spans directories.
+// Matching is case-insensitive and works on '/'-separated paths relative to
+// the directory holding the ignore file. Only the path itself is tested;
+// ancestors are the caller's business (see GitIgnoreStack).
+class GitIgnoreMatcher {
+public:
+    enum class Result {
+        NoMatch,
+        Ignored,
+        Included   // matched by a "!" pattern
+    };
+
+    GitIgnoreMatcher() = default;
+    explicit GitIgnoreMatcher(const QStringList& patterns);
+
+    void addPatterns(const QStringList& patterns);
+    bool isEmpty() const { return m_negated.isEmpty(); }
+    int patternCount() const { return m_negated.size(); }
+
+    Result match(QStringView relativePath, bool isDir) const;
+
+private:
+    struct LiteralRule {
+        QString text;
+        int index;
+        bool dirOnly;
+    };
+    using LiteralTable = QHash<size_t, QVector<LiteralRule>>;
+
+    struct GlobSet {
+        QStringList regexes;
+        QVector<int> indexes;   // ascending, parallel to regexes
+        QRegularExpression rx;
+
+        bool isEmpty() const { return indexes.isEmpty(); }
+        void compile();
+        int match(QStringView subject) const;
+    };
+
+    static size_t foldedHash(QStringView text);
+    static int lookupLiteral(const LiteralTable& table, QStringView text, bool isDir);
+
+    void addPattern(QString pattern);
+    void compileGlobs();
+
+    LiteralTable m_names;       // "name" and "name/"
+    LiteralTable m_extensions;  // "*.ext", keyed without the "*."
+    LiteralTable m_paths;       // "dir/sub" and "/name", relative to the ignore file
+
+    GlobSet m_nameGlobs;
+    GlobSet m_dirNameGlobs;
+    GlobSet m_pathGlobs;
+    GlobSet m_dirPathGlobs;
+
+    QVector<bool> m_negated;    // one entry per accepted pattern, in file order
+};
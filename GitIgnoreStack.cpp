@@ -0,0 +1,82 @@
+#include "GitIgnoreStack.h"
+#include <QFile>
+#include <QTextStream>
+
+QStringList GitIgnoreStack::readPatternFile(const QString& filePath) {
+    QStringList patterns;
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&file);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (!line.isEmpty() && !line.startsWith('#')) {
+                patterns.append(line);
+            }
+        }
+    }
+    return patterns;
+}
+
+void GitIgnoreStack::push(const QString& baseDir, const QStringList& patterns) {
+    if (patterns.isEmpty()) {
+        return;
+    }
+
+    auto frame = QSharedPointer<Frame>::create();
+    frame->rootPath = m_top ? m_top->rootPath : QString();
+    frame->baseDir = baseDir;
+    frame->matcher.addPatterns(patterns);
+    frame->parent = m_top;
+    m_top = frame;
+}
+
+GitIgnoreStack GitIgnoreStack::forRoot(const QString& rootPath, const QStringList& defaultPatterns) {
+    // The bottom frame always exists so every frame can carry the root path
+    auto base = QSharedPointer<Frame>::create();
+    base->rootPath = rootPath;
+    base->matcher.addPatterns(defaultPatterns);
+
+    GitIgnoreStack stack;
+    stack.m_top = base;
+    stack.push(QString(), readPatternFile(rootPath + "/.git/info/exclude"));
+    stack.push(QString(), readPatternFile(rootPath + "/.gitignore"));
+    return stack;
+}
+
+GitIgnoreStack GitIgnoreStack::enterDirectory(const QString& relativeDir) const {
+    GitIgnoreStack stack = *this;
+    if (m_top) {
+        stack.push(relativeDir, readPatternFile(m_top->rootPath + '/' + relativeDir + "/.gitignore"));
+    }
+    return stack;
+}
+
+const QString& GitIgnoreStack::rootPath() const {
+    static const QString empty;
+    return m_top ? m_top->rootPath : empty;
+}
+
+bool GitIgnoreStack::isIgnored(QStringView relativePath, bool isDir) const {
+    for (const Frame* frame = m_top.data(); frame; frame = frame->parent.data()) {
+        QStringView local = relativePath;
+        if (!frame->baseDir.isEmpty()) {
+            // Frames belong to ancestors of the queried path, so this is a slice
+            if (relativePath.size() <= frame->baseDir.size() ||
+                relativePath[frame->baseDir.size()] != '/' ||
+                !relativePath.startsWith(frame->baseDir)) {
+                continue;
+            }
+            local = relativePath.mid(frame->baseDir.size() + 1);
+        }
+
+        switch (frame->matcher.match(local, isDir)) {
+        case GitIgnoreMatcher::Result::Ignored:
+            return true;
+        case GitIgnoreMatcher::Result::Included:
+            return false;
+        case GitIgnoreMatcher::Result::NoMatch:
+            break;
+        }
+    }
+    return false;
+}
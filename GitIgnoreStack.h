@@ -0,0 +1,49 @@
+// GitIgnoreStack.h
+#pragma once
+
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include "GitIgnoreMatcher.h"
+
+// The ignore rules in effect inside one directory of a project.
+//
+// Each directory that has a .gitignore pushes a frame on top of its parent's
+// stack; directories without one share the parent's stack. Frames are
+// immutable and reference counted, so a walker can push one per directory it
+// enters and pop it by simply dropping the copy, and concurrent walkers can
+// share frames. Precedence follows git: deeper .gitignore files first, then
+// the root .gitignore, then .git/info/exclude, then the built-in defaults.
+class GitIgnoreStack {
+public:
+    GitIgnoreStack() = default;
+
+    // Stack for the project root: defaults, .git/info/exclude and .gitignore
+    static GitIgnoreStack forRoot(const QString& rootPath, const QStringList& defaultPatterns);
+
+    // Stack for a subdirectory of the directory this stack belongs to.
+    // relativeDir is relative to the project root.
+    GitIgnoreStack enterDirectory(const QString& relativeDir) const;
+
+    // Rules for the entry itself only; callers walking the tree never reach
+    // entries below an ignored directory, so ancestors need no re-checking.
+    bool isIgnored(QStringView relativePath, bool isDir) const;
+    bool isDirectoryIgnored(QStringView relativeDir) const { return isIgnored(relativeDir, true); }
+
+    const QString& rootPath() const;
+    bool isNull() const { return m_top.isNull(); }
+
+private:
+    struct Frame {
+        QString rootPath;
+        QString baseDir;        // relative to the root, empty for the root itself
+        GitIgnoreMatcher matcher;
+        QSharedPointer<const Frame> parent;
+    };
+
+    static QStringList readPatternFile(const QString& filePath);
+    void push(const QString& baseDir, const QStringList& patterns);
+
+    QSharedPointer<const Frame> m_top;
+};
@@ -0,0 +1,212 @@
+#include "HeadlessExport.h"
+#include "FileExtensionConfig.h"
+#include "FileProcessingWorker.h"
+#include "FilterEngine.h"
+#include "GitIgnoreMatcher.h"
+#include "ParallelTreeWalker.h"
+#include "ScanIndex.h"
+#include "ScanSnapshot.h"
+#include <QBitArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+bool verboseLog = false;
+
+// The executable is built for the GUI subsystem, so on Windows it starts
+// without a console and whatever isn't redirected goes nowhere. Streams
+// the shell didn't redirect are pointed at the console it was started
+// from, if any; redirected ones are left alone.
+void attachParentConsole() {
+#ifdef Q_OS_WIN
+    const auto unset = [](DWORD stdHandle) {
+        const HANDLE handle = ::GetStdHandle(stdHandle);
+        return handle == nullptr || handle == INVALID_HANDLE_VALUE;
+    };
+    const bool reopenOutput = unset(STD_OUTPUT_HANDLE);
+    const bool reopenError = unset(STD_ERROR_HANDLE);
+    if ((!reopenOutput && !reopenError) || !::AttachConsole(ATTACH_PARENT_PROCESS)) {
+        return;
+    }
+    if (reopenOutput && std::freopen("CONOUT$", "w", stdout)) {
+        ::SetStdHandle(STD_OUTPUT_HANDLE, ::CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr));
+    }
+    if (reopenError && std::freopen("CONOUT$", "w", stderr)) {
+        ::SetStdHandle(STD_ERROR_HANDLE, ::CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr));
+    }
+#endif
+}
+
+// Standard output may be carrying the export, so everything else goes to
+// stderr; debug output only with --verbose
+void headlessMessageHandler(QtMsgType type, const QMessageLogContext&, const QString& msg) {
+    if ((type == QtDebugMsg || type == QtInfoMsg) && !verboseLog) {
+        return;
+    }
+    std::fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+}
+
+void report(const QString& message) {
+    std::fprintf(stderr, "%s\n", message.toLocal8Bit().constData());
+}
+
+// Whether relativePath, or a directory above it, matches one of the
+// patterns; the matcher itself only tests the path it is given
+bool matches(const GitIgnoreMatcher& matcher, QStringView relativePath) {
+    for (qsizetype slash = relativePath.indexOf('/'); slash >= 0;
+         slash = relativePath.indexOf('/', slash + 1)) {
+        if (matcher.match(relativePath.left(slash), true) == GitIgnoreMatcher::Result::Ignored) {
+            return true;
+        }
+    }
+    return matcher.match(relativePath, false) == GitIgnoreMatcher::Result::Ignored;
+}
+}
+
+bool HeadlessExport::requested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--") == 0) {
+            break;
+        }
+        if (std::strcmp(argv[i], "--export") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HeadlessExport::run(const QCoreApplication& app) {
+    QElapsedTimer timer;
+    timer.start();
+    attachParentConsole();
+    qInstallMessageHandler(headlessMessageHandler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Exports the text files under root as one document, without opening a window.");
+    const QCommandLineOption helpOption = parser.addHelpOption();
+    const QCommandLineOption versionOption = parser.addVersionOption();
+    const QCommandLineOption exportOption("export", "Export root from the command line.");
+    const QCommandLineOption outputOption({"o", "output"},
+        "Write to <file> instead of standard output (-). .gz and .zst names are compressed.", "file", "-");
+    const QCommandLineOption includeOption({"i", "include"},
+        "Only export files matching <pattern>, in .gitignore syntax. Repeatable.", "pattern");
+    const QCommandLineOption excludeOption({"x", "exclude"},
+        "Leave out files matching <pattern>, in .gitignore syntax. Repeatable.", "pattern");
+    const QCommandLineOption configOption({"c", "config"},
+        "Read settings from <file> instead of the built-in file_extensions.json.", "file");
+    const QCommandLineOption verboseOption({"v", "verbose"}, "Log progress to stderr.");
+    parser.addOptions({exportOption, outputOption, includeOption, excludeOption, configOption, verboseOption});
+    parser.addPositionalArgument("root", "Directory to export.");
+
+    if (!parser.parse(app.arguments())) {
+        report(parser.errorText() + "\nTry --help.");
+        return UsageError;
+    }
+    if (parser.isSet(helpOption)) {
+        parser.showHelp(Success);
+    }
+    if (parser.isSet(versionOption)) {
+        parser.showVersion();
+    }
+    verboseLog = parser.isSet(verboseOption);
+
+    const QStringList roots = parser.positionalArguments();
+    if (roots.size() != 1) {
+        report("Expected one root directory.\nTry --help.");
+        return UsageError;
+    }
+    const QFileInfo rootInfo(roots.first());
+    if (!rootInfo.isDir()) {
+        report("Not a directory: " + roots.first());
+        return UsageError;
+    }
+    const QString rootPath = QDir::cleanPath(rootInfo.absoluteFilePath());
+
+    // Before anything reads the configuration
+    if (parser.isSet(configOption)) {
+        const QString configPath = parser.value(configOption);
+        if (!QFileInfo(configPath).isFile()) {
+            report("No such config file: " + configPath);
+            return UsageError;
+        }
+        FileExtensionConfig::setConfigPath(configPath);
+    }
+    const GitIgnoreMatcher includeMatcher(parser.values(includeOption));
+    const GitIgnoreMatcher excludeMatcher(parser.values(excludeOption));
+
+    // The index the window keeps for this root makes the scan a check of
+    // what changed
+    auto filterEngine = QSharedPointer<const FilterEngine>::create(rootPath);
+    ParallelTreeWalker walker(filterEngine);
+    walker.setPreviousSnapshot(ScanIndex::load(rootPath));
+    walker.walk();
+    const QSharedPointer<ScanSnapshot> snapshot = walker.snapshot();
+    if (!snapshot) {
+        report("Could not scan " + rootPath);
+        return ExportFailed;
+    }
+    qDebug() << "Scanned" << snapshot->nodeCount() << "entries in" << timer.elapsed() << "ms";
+
+    // Selectable the way the window's tree has it, then narrowed down
+    QBitArray selectedFiles(snapshot->nodeCount());
+    int selectedCount = 0;
+    for (int node = 1; node < snapshot->nodeCount(); ++node) {
+        if ((snapshot->flags(node) & ScanSnapshot::Removed) ||
+            snapshot->isDirectory(node) || !snapshot->isAccepted(node)) {
+            continue;
+        }
+        const QString relativePath = snapshot->relativePath(node);
+        if ((!includeMatcher.isEmpty() && !matches(includeMatcher, relativePath)) ||
+            matches(excludeMatcher, relativePath)) {
+            continue;
+        }
+        selectedFiles.setBit(node);
+        ++selectedCount;
+    }
+    if (selectedCount == 0) {
+        report("No files to export under " + rootPath);
+        return NothingToExport;
+    }
+
+    // Saved while the export runs, for the next run or the window
+    std::unique_ptr<QThread> indexWriter(QThread::create([snapshot]() { ScanIndex::save(*snapshot); }));
+    indexWriter->start();
+
+    // No thread and no event loop: the worker's signals are delivered
+    // directly, before process() returns
+    FileProcessingWorker worker(snapshot, selectedFiles);
+    worker.setOutputPath(parser.value(outputOption));
+    int exitCode = ExportFailed;
+    QObject::connect(&worker, &FileProcessingWorker::finished, [&exitCode]() { exitCode = Success; });
+    QObject::connect(&worker, &FileProcessingWorker::error, [](const QString& message) { report(message); });
+    worker.process();
+    indexWriter->wait();
+
+    if (exitCode == Success) {
+        const QSharedPointer<const ProcessingProgress> progress = worker.progress();
+        QString summary = QString("Exported %1 files, %2 bytes (~%3 tokens) in %4 ms")
+            .arg(progress->processedFiles.load(std::memory_order_relaxed))
+            .arg(progress->totalSize.load(std::memory_order_relaxed))
+            .arg(progress->tokens.load(std::memory_order_relaxed))
+            .arg(timer.elapsed());
+        if (!progress->manifestPath.isEmpty()) {
+            summary += ", split into parts listed in " + progress->manifestPath;
+        }
+        report(summary);
+    }
+    return exitCode;
+}
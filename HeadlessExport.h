@@ -0,0 +1,31 @@
+// HeadlessExport.h
+#pragma once
+
+class QCoreApplication;
+
+// Exports a directory from the command line, without a window:
+//
+//   codebase_processor --export <root> [-o <file>] [-i <pattern>]... [-x <pattern>]... [-c <config>]
+//
+// The scan, filters and export are the ones the window uses, and the scan
+// index is shared with it. Output goes to standard output unless a file is
+// named, and is written as files are read. Only a QCoreApplication exists,
+// so nothing waits on a display, a style or fonts. On Windows, standard
+// output and error that weren't redirected go to the console of the shell
+// that started the GUI-subsystem executable.
+class HeadlessExport {
+public:
+    enum ExitCode {
+        Success = 0,
+        ExportFailed = 1,       // a file couldn't be read or the output written
+        UsageError = 2,         // bad arguments, root or config file
+        NothingToExport = 3     // no file passed the filters
+    };
+
+    // Whether the arguments ask for a headless export; checked before any
+    // application object is created
+    static bool requested(int argc, char* argv[]);
+
+    // Parses app's arguments and exports; returns the process exit code
+    static int run(const QCoreApplication& app);
+};
@@ -1,23 +1,34 @@
 #include "MainWindow.h"
-#include "FileSystemModelWithGitIgnore.h"
+#include "ScanTreeModel.h"
 #include "ProcessingDialog.h"
 #include "FileProcessingWorker.h"
+#include "ParallelTreeWalker.h"
+#include "ScanIndex.h"
+#include "BlockCompressor.h"
+#include "ContentCache.h"
+#include "FileExtensionConfig.h"
+#include "FileReader.h"
+#include "RopeMimeData.h"
 
 #include <QVBoxLayout>
 #include <QPushButton>
 #include <QTreeView>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
-#include <QDirIterator>
 #include <QClipboard>
 #include <QApplication>
-#include <QFileSystemWatcher>
 #include <QThread>
 #include <QTimer>
 #include <QStandardPaths>
-#include <QItemSelectionModel>
+#include <QLocale>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
 #include <QDebug>
 
 MainWindow::MainWindow(QWidget *parent) 
@@ -35,26 +46,13 @@ MainWindow::MainWindow(QWidget *parent)
 void MainWindow::delayedInit()
 {
     setupUI();
-    
-    // Additional setup for file model
-    fileModel->setFilter(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
 }
 
 MainWindow::~MainWindow()
 {
     // Clean up worker thread explicitly
     if (workerThread) {
-        if (workerThread->isRunning()) {
-            workerThread->quit();
-            workerThread->wait(1000); // Wait up to 1 second for thread to terminate
-        }
-        
-        // Additional safety checks
-        if (workerThread->isRunning()) {
-            qWarning() << "Worker thread did not terminate gracefully";
-            workerThread->terminate(); // Last resort, but not recommended
-        }
-        
+        stopFileProcessing();
         delete workerThread;
         workerThread = nullptr;
     }
@@ -73,9 +71,9 @@ MainWindow::~MainWindow()
         fileModel = nullptr;
     }
 
-    if (gitignoreWatcher) {
-        delete gitignoreWatcher;
-        gitignoreWatcher = nullptr;
+    if (changeTracker) {
+        delete changeTracker;
+        changeTracker = nullptr;
     }
 }
 
@@ -94,9 +92,9 @@ void MainWindow::setupUI()
     fileTreeView = new QTreeView(this);
     fileTreeView->setUniformRowHeights(true);
     fileTreeView->setEnabled(false);
-    fileTreeView->setSortingEnabled(false); // Enable only after folder selection
-    // Make sure multi-selection is enabled so multiple files can be selected
-    fileTreeView->setSelectionMode(QAbstractItemView::MultiSelection);
+    fileTreeView->setSortingEnabled(false); // Rows keep the scanner's order: folders first, then by name
+    // Check boxes choose what is exported; row selection is only for navigation
+    fileTreeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     fileTreeView->setSelectionBehavior(QAbstractItemView::SelectRows);
     mainLayout->addWidget(fileTreeView);
 
@@ -115,19 +113,14 @@ void MainWindow::setupUI()
     saveFileButton->setEnabled(false);
     saveClipboardButton->setEnabled(false);
 
-    // Initialize file system model
-    fileModel = new FileSystemModelWithGitIgnore(this);
-    fileModel->setReadOnly(true);
+    // The model shows scan snapshots; it is empty until a folder is scanned
+    fileModel = new ScanTreeModel(this);
     fileTreeView->setModel(fileModel);
 
-    // Set up selection handling after model is set
-    connect(fileTreeView->selectionModel(), &QItemSelectionModel::selectionChanged,
-            this, &MainWindow::handleSelectionChanged);
+    connect(fileModel, &ScanTreeModel::selectedCountChanged, this, [](int selectedFiles) {
+        qDebug() << "Total files selected:" << selectedFiles;
+    });
 
-    // Set up gitignore watcher
-    gitignoreWatcher = new QFileSystemWatcher(this);
-    connect(gitignoreWatcher, &QFileSystemWatcher::fileChanged,
-            this, &MainWindow::onGitIgnoreChanged);
 }
 
 void MainWindow::selectFolder()
@@ -144,133 +137,279 @@ void MainWindow::selectFolder()
         
         // Use a timer to allow the UI to update
         QTimer::singleShot(0, this, [this, dir]() {
-            currentPath = dir;
-            
-            // Set up the model with the new path
-            QModelIndex rootIndex = fileModel->setRootPath(dir);
-            fileTreeView->setRootIndex(rootIndex);
-            
-            // Update .gitignore patterns if present
-            QString gitignorePath = dir + "/.gitignore";
-            if (QFile::exists(gitignorePath)) {
-                gitignoreWatcher->addPath(gitignorePath);
-                fileModel->updateGitIgnorePatterns(dir);
+            // Leave the previous root: stop applying its changes and keep
+            // what they did to its index
+            if (treeWalker) {
+                delete treeWalker;
+                treeWalker = nullptr;
             }
-            
-            // Clear previous selection
-            selectedFiles.clear();
-            fileTreeView->selectionModel()->clearSelection();
-            
-            // Manually populate selection
-            QDirIterator it(dir, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-            while (it.hasNext()) {
-                QString filePath = it.next();
-                if (fileModel->shouldIncludeFile(filePath)) {
-                    selectedFiles.insert(filePath);
-                    QModelIndex index = fileModel->index(filePath);
-                    if (index.isValid()) {
-                        fileTreeView->selectionModel()->select(
-                            index,
-                            QItemSelectionModel::Select | QItemSelectionModel::Rows
-                        );
-                    }
-                    qDebug() << "Auto selecting:" << filePath;
-                }
+            pendingChanges = ChangeSet();
+            saveScanIndex();
+            // Nothing cached for the previous root will be asked for again
+            if (contentCache) {
+                contentCache->clear();
             }
-            
-            qDebug() << "Total auto-selected files:" << selectedFiles.size();
 
-            // Expand the entire directory tree
-            expandEntireDirectoryTree(rootIndex);
+            currentPath = dir;
+
+            // Edits below the root are picked up as they happen; the watches
+            // are placed once the scan knows which directories matter
+            delete changeTracker;
+            changeTracker = new ChangeTracker(dir, this);
+            connect(changeTracker, &ChangeTracker::changed,
+                    this, &MainWindow::onFilesystemChanged);
 
-            // Enable UI elements
-            fileTreeView->setEnabled(true);
-            saveFileButton->setEnabled(true);
-            saveClipboardButton->setEnabled(true);
-            fileTreeView->setSortingEnabled(true);
+            // One filter per root, shared by the model, the scan and the export
+            filterEngine = QSharedPointer<const FilterEngine>::create(dir);
             
-            QApplication::restoreOverrideCursor();
+            // A root we have seen before is selected straight from its index;
+            // the scan below then only re-reads directories that changed
+            scanSnapshot = ScanIndex::load(dir);
+            fileModel->setSnapshot(scanSnapshot);
+            if (scanSnapshot) {
+                qDebug() << "Loaded scan index with" << scanSnapshot->nodeCount() << "entries";
+                showScannedTree();
+            }
+
+            // Build the tree from a parallel walk that never enters ignored
+            // directories; its accepted files start out checked
+            treeWalker = new ParallelTreeWalker(filterEngine, this);
+            treeWalker->setPreviousSnapshot(scanSnapshot);
+            const int generation = ++scanGeneration;
+            connect(treeWalker, &ParallelTreeWalker::finished, this, [this, generation]() {
+                if (generation == scanGeneration) {
+                    onScanFinished();
+                }
+            });
+
+            selectFolderButton->setEnabled(false);
+            treeWalker->start();
         });
     }
 }
 
+void MainWindow::onScanFinished()
+{
+    QSharedPointer<ScanSnapshot> freshSnapshot = treeWalker->snapshot();
+    treeWalker->deleteLater();
+    treeWalker = nullptr;
+    selectFolderButton->setEnabled(true);
 
+    if (!freshSnapshot) {
+        return;
+    }
+
+    bool wasCached = !scanSnapshot.isNull();
+    QStringList expandedDirectories;
+    QStringList uncheckedFiles;
+    if (wasCached) {
+        // The cached tree is replaced below; remember what the user opened
+        // and unchecked. Everything else accepted by the fresh scan, new
+        // files included, starts out checked.
+        const QBitArray checked = fileModel->selection().files();
+        for (int node = 1; node < scanSnapshot->nodeCount(); ++node) {
+            if ((scanSnapshot->flags(node) & ScanSnapshot::Listed) &&
+                fileTreeView->isExpanded(fileModel->indexForNode(node))) {
+                expandedDirectories.append(scanSnapshot->absolutePath(node));
+            } else if (fileModel->selection().isSelectable(node) &&
+                       !scanSnapshot->isDirectory(node) && !checked.testBit(node)) {
+                uncheckedFiles.append(scanSnapshot->relativePath(node));
+            }
+        }
+    }
+    // The live snapshot is updated in place from here on; the index writer
+    // gets its own copy taken before anything can touch it
+    auto indexCopy = QSharedPointer<ScanSnapshot>::create(*freshSnapshot);
+    scanSnapshot = freshSnapshot;
+    fileModel->setSnapshot(scanSnapshot);
+    changeTracker->watchSnapshot(*scanSnapshot);
+
+    for (const QString& relativePath : uncheckedFiles) {
+        fileModel->setSelected(scanSnapshot->findNode(relativePath), false);
+    }
+    for (const QString& directory : expandedDirectories) {
+        fileTreeView->expand(fileModel->index(directory));
+    }
+
+    // Persist for the next time this root is opened, off the GUI thread
+    QThread* indexWriter = QThread::create([indexCopy]() { ScanIndex::save(*indexCopy); });
+    connect(indexWriter, &QThread::finished, indexWriter, &QObject::deleteLater);
+    indexWriter->start();
+    scanIndexDirty = false;
+
+    qDebug() << "Total auto-selected files:" << fileModel->selection().selectedCount();
+
+    if (!wasCached) {
+        showScannedTree();
+    }
 
+    // Changes that arrived while scanning
+    if (!pendingChanges.isEmpty()) {
+        applyChanges(std::exchange(pendingChanges, ChangeSet()));
+    }
+}
 
-void MainWindow::expandEntireDirectoryTree(const QModelIndex& parentIndex, int depth)
+void MainWindow::onFilesystemChanged(const ChangeSet& changes)
 {
-    if (depth > 10) return; // Prevent excessive recursion
-    
-    fileTreeView->expand(parentIndex);
-    int rows = fileModel->rowCount(parentIndex);
-    
-    for (int i = 0; i < rows; ++i) {
-        QModelIndex childIndex = fileModel->index(i, 0, parentIndex);
-        if (fileModel->isDir(childIndex)) {
-            expandEntireDirectoryTree(childIndex, depth + 1);
-        }
-        
-        // Check if the file should be included and select it
-        if (fileModel->shouldIncludeFile(fileModel->filePath(childIndex))) {
-            fileTreeView->selectionModel()->select(childIndex, QItemSelectionModel::Select | QItemSelectionModel::Rows);
-            selectedFiles.insert(fileModel->filePath(childIndex));
-        }
+    // Scans own the snapshot until they finish; keep the changes until then
+    if (treeWalker || !scanSnapshot) {
+        pendingChanges.unite(changes);
+        return;
     }
+    applyChanges(changes);
 }
 
-void MainWindow::handleSelectionChanged(const QItemSelection& selected, 
-                                        const QItemSelection& deselected)
+void MainWindow::applyChanges(const ChangeSet& changes)
 {
-    // Process newly selected items
-    for (const QModelIndex& index : selected.indexes()) {
-        if (index.column() == 0) {  // Only process the first column
-            QString filePath = fileModel->filePath(index);
-            // Check if it's a file
-            QFileInfo fileInfo(filePath);
-            if (fileInfo.isFile()) {
-                selectedFiles.insert(filePath);
-                qDebug() << "Added to selection:" << filePath;
+    // New ignore rules need a new filter; the directories below the changed
+    // ignore file are re-evaluated by the walk further down
+    if (changes.overflowed || !changes.ignoreDirectories.isEmpty()) {
+        filterEngine = QSharedPointer<const FilterEngine>::create(currentPath);
+    }
+
+    // Edited files only need a new stat
+    for (const QString& relativePath : changes.modifiedFiles) {
+        updateModifiedFile(relativePath);
+    }
+
+    // Directories whose entries changed are re-read by a walk limited to them.
+    // After lost events the whole tree is walked, which still only re-reads
+    // directories whose mtime moved. Either way every file the walk passes
+    // is stat'ed again: edits lost with the events, or never reported where
+    // the watcher only knows about directories, move no directory's mtime.
+    auto* walker = new ParallelTreeWalker(filterEngine, this);
+    walker->setRestatFiles(true);
+    int scopes = 0;
+    if (changes.overflowed) {
+        walker->addScope(QString(), true);
+        ++scopes;
+    } else {
+        for (const QString& relativeDir : changes.ignoreDirectories) {
+            if (scanSnapshot->findDirectory(relativeDir) >= 0) {
+                walker->addScope(relativeDir, true);
+                ++scopes;
+            }
+        }
+        for (const QString& relativeDir : changes.changedDirectories) {
+            if (scanSnapshot->findDirectory(relativeDir) >= 0 &&
+                !changes.ignoreDirectories.contains(relativeDir)) {
+                walker->addScope(relativeDir, false);
+                ++scopes;
             }
         }
     }
-    
-    // Process deselected items
-    for (const QModelIndex& index : deselected.indexes()) {
-        if (index.column() == 0) {  // Only process the first column
-            QString filePath = fileModel->filePath(index);
-            selectedFiles.erase(filePath);
-            qDebug() << "Removed from selection:" << filePath;
+    if (scopes == 0) {
+        delete walker;
+        return;
+    }
+
+    // The walk reads a copy, the GUI keeps updating the original
+    treeWalker = walker;
+    treeWalker->setPreviousSnapshot(QSharedPointer<const ScanSnapshot>::create(*scanSnapshot));
+    // A walk that was abandoned for another root may still deliver finished()
+    const int generation = ++scanGeneration;
+    connect(treeWalker, &ParallelTreeWalker::finished, this, [this, generation]() {
+        if (generation == scanGeneration) {
+            onChangesScanned();
         }
+    });
+    treeWalker->start();
+}
+
+void MainWindow::updateModifiedFile(const QString& relativePath)
+{
+    int node = scanSnapshot->findNode(relativePath);
+    if (node < 0 || scanSnapshot->isDirectory(node) ||
+        (scanSnapshot->flags(node) & ScanSnapshot::Removed)) {
+        return;
+    }
+
+    // Name based verdicts cannot change with the contents
+    FilterEngine::Verdict before = scanSnapshot->verdict(node);
+    if (before != FilterEngine::Verdict::Accepted &&
+        before != FilterEngine::Verdict::TooLarge &&
+        before != FilterEngine::Verdict::NotReadable) {
+        return;
+    }
+
+    QString filePath = currentPath + '/' + relativePath;
+    ScanEntry entry;
+    if (!ParallelTreeWalker::statEntry(filePath, entry) || !entry.isRegularFile()) {
+        entry.verdict = FilterEngine::Verdict::NotReadable;
+    } else {
+        entry.verdict = filterEngine->checkFileSize(entry.size);
+    }
+    // The model checks or unchecks the file when the verdict flips
+    fileModel->updateFile(node, entry);
+    if (before != entry.verdict) {
+        scanIndexDirty = true;
     }
-    
-    qDebug() << "Total files selected:" << selectedFiles.size();
 }
 
-void MainWindow::expandDirectory(const QModelIndex& index, int depth)
+void MainWindow::onChangesScanned()
 {
-    if (depth <= 0) return;
-    
-    fileTreeView->expand(index);
-    int rows = fileModel->rowCount(index);
-    
-    for (int i = 0; i < rows; ++i) {
-        QModelIndex childIndex = fileModel->index(i, 0, index);
-        if (fileModel->isDir(childIndex)) {
-            expandDirectory(childIndex, depth - 1);
+    std::vector<ScanListing> listings = treeWalker->takeListings();
+    treeWalker->deleteLater();
+    treeWalker = nullptr;
+
+    // Parents first, so directories created by one listing exist for the next
+    std::sort(listings.begin(), listings.end(), [](const ScanListing& a, const ScanListing& b) {
+        return a.relativeDir.size() < b.relativeDir.size();
+    });
+
+    QVector<int> gained;
+    QVector<int> lost;
+    QStringList droppedDirectories;
+    for (const ScanListing& listing : listings) {
+        if (fileModel->applyListing(listing, gained, lost, droppedDirectories)) {
+            changeTracker->watchDirectory(listing.relativeDir);
         }
     }
+    for (const QString& relativeDir : droppedDirectories) {
+        if (scanSnapshot->findDirectory(relativeDir) < 0) {
+            changeTracker->unwatchDirectory(relativeDir);
+        }
+    }
+
+    scanIndexDirty = true;
+    qDebug() << "Applied changes in" << listings.size() << "directories:"
+             << gained.size() << "files selected," << lost.size() << "deselected";
+
+    if (!pendingChanges.isEmpty()) {
+        applyChanges(std::exchange(pendingChanges, ChangeSet()));
+    }
 }
 
-void MainWindow::onGitIgnoreChanged()
+void MainWindow::saveScanIndex()
 {
-    // When .gitignore changes, update the patterns and refresh the view
-    fileModel->updateGitIgnorePatterns(currentPath);
+    if (!scanSnapshot || !scanIndexDirty) {
+        return;
+    }
+    scanIndexDirty = false;
+
+    // Incremental updates leave removed nodes behind; the index gets a
+    // compact copy, written on its own thread
+    auto compacted = QSharedPointer<ScanSnapshot>::create(scanSnapshot->compacted());
+    QThread* indexWriter = QThread::create([compacted]() { ScanIndex::save(*compacted); });
+    connect(indexWriter, &QThread::finished, indexWriter, &QObject::deleteLater);
+    indexWriter->start();
+}
+
+void MainWindow::showScannedTree()
+{
+    // Enable UI elements; directories are expanded on demand
+    fileTreeView->setEnabled(true);
+    saveFileButton->setEnabled(true);
+    saveClipboardButton->setEnabled(true);
+
+    QApplication::restoreOverrideCursor();
 }
 
 void MainWindow::startFileProcessing(bool toClipboard)
 {
     // Validate that we have files to process
-    if (selectedFiles.empty()) {
+    const FileSelection& selection = fileModel->selection();
+    if (selection.selectedCount() == 0) {
         QMessageBox::warning(this, "No Files Selected",
                              "Please select files to process first.");
         return;
@@ -279,47 +418,36 @@ void MainWindow::startFileProcessing(bool toClipboard)
     // Ensure any previous worker thread is properly cleaned up
     if (workerThread) {
         if (workerThread->isRunning()) {
-            workerThread->quit();
-            if (!workerThread->wait(2000)) { // Wait up to 2 seconds
-                qWarning() << "Worker thread did not terminate gracefully. Attempting to terminate.";
-                workerThread->terminate(); // Last resort
-            }
+            stopFileProcessing();
             delete workerThread;
             workerThread = nullptr;
         }
     }
 
-    // Create a set of files that should actually be processed
-    std::set<QString> filesToProcess;
-    int processableFilesCount = 0;
+    // Only accepted files can be checked, and the change tracker keeps their
+    // verdicts and sizes current, so the snapshot answers without a stat
+    const QBitArray filesToProcess = selection.files();
+    int processableFilesCount = selection.selectedCount();
     qint64 totalProcessableSize = 0;
-
-    // Detailed file filtering with logging
-    for (const QString& filePath : selectedFiles) {
-        if (fileModel->shouldIncludeFile(filePath)) {
-            QFileInfo fileInfo(filePath);
-            
-            if (fileInfo.isFile()) {
-                try {
-                    // Additional safety checks
-                    if (!fileInfo.isReadable()) {
-                        qWarning() << "File not readable:" << filePath;
-                        continue;
-                    }
-
-                    filesToProcess.insert(filePath);
-                    processableFilesCount++;
-                    totalProcessableSize += fileInfo.size();
-                } catch (const std::exception& e) {
-                    qWarning() << "Error processing file:" << filePath 
-                               << "Exception:" << e.what();
-                }
-            }
+    // Tokens as counted by the last export for files it read, estimated
+    // from the size for the rest
+    qint64 estimatedTokens = 0;
+    std::vector<std::pair<qint64, int>> fileTokens;
+    fileTokens.reserve(static_cast<size_t>(processableFilesCount));
+    for (qsizetype node = 0; node < filesToProcess.size(); ++node) {
+        if (filesToProcess.testBit(node)) {
+            const int file = static_cast<int>(node);
+            totalProcessableSize += FileReader::exportedSize(scanSnapshot->size(file));
+            const qint64 tokens = FileProcessingWorker::estimateTokens(
+                contentCache.get(), scanSnapshot->rootPath() + '/' + scanSnapshot->relativePath(file),
+                scanSnapshot->record(file));
+            estimatedTokens += tokens;
+            fileTokens.emplace_back(tokens, file);
         }
     }
 
     // Validate processable files
-    if (filesToProcess.empty()) {
+    if (processableFilesCount == 0) {
         QMessageBox::warning(this, "No Valid Files",
                              "None of the selected items can be processed. "
                              "Please select valid files or check file extension configuration.");
@@ -329,17 +457,51 @@ void MainWindow::startFileProcessing(bool toClipboard)
     // Log processing details
     qDebug() << "Processing " << processableFilesCount << " files"
              << "Total processable size:" << totalProcessableSize << "bytes"
+             << "Estimated tokens:" << estimatedTokens
              << "Destination:" << (toClipboard ? "Clipboard" : "File");
 
+    // Warn before an export that can't fit the token budget, naming the
+    // files that take the most of it
+    const FileExtensionConfig& config = FileExtensionConfig::getInstance();
+    if (config.getTokenBudget() > 0 && estimatedTokens > config.getTokenBudget()) {
+        constexpr size_t kListedFiles = 5;
+        const size_t listed = std::min(kListedFiles, fileTokens.size());
+        std::partial_sort(fileTokens.begin(), fileTokens.begin() + static_cast<std::ptrdiff_t>(listed),
+                          fileTokens.end(), std::greater<>());
+        QStringList largest;
+        for (size_t i = 0; i < listed; ++i) {
+            largest << QString("%1 (~%2 tokens)")
+                .arg(scanSnapshot->relativePath(fileTokens[i].second))
+                .arg(QLocale().toString(fileTokens[i].first));
+        }
+        QMessageBox::StandardButton reply = QMessageBox::question(
+            this,
+            "Over Token Budget",
+            QString("The selection comes to about %1 tokens, over the budget of %2.\n\n"
+                    "Largest files:\n  %3\n\n%4 Continue?")
+                .arg(QLocale().toString(estimatedTokens))
+                .arg(QLocale().toString(config.getTokenBudget()))
+                .arg(largest.join("\n  "))
+                .arg(config.getTokenBudgetStops()
+                     ? "The export will stop at the first file that doesn't fit."
+                     : "The largest files will be left out until the rest fits."),
+            QMessageBox::Yes | QMessageBox::No
+        );
+        if (reply == QMessageBox::No) {
+            return;
+        }
+    }
+
     // Optional: Confirm processing large files
     const qint64 LARGE_FILE_THRESHOLD_MB = 100; // 100 MB
     if (totalProcessableSize > (LARGE_FILE_THRESHOLD_MB * 1024 * 1024)) {
         QMessageBox::StandardButton reply = QMessageBox::question(
             this, 
             "Large File Set", 
-            QString("You are about to process %1 files totaling %2 MB. Continue?")
+            QString("You are about to process %1 files totaling %2 MB (about %3 tokens). Continue?")
                 .arg(processableFilesCount)
-                .arg(totalProcessableSize / (1024 * 1024)),
+                .arg(totalProcessableSize / (1024 * 1024))
+                .arg(QLocale().toString(estimatedTokens)),
             QMessageBox::Yes | QMessageBox::No
         );
         
@@ -348,6 +510,29 @@ void MainWindow::startFileProcessing(bool toClipboard)
         }
     }
 
+    // Saving needs the destination before it starts: the worker writes
+    // each file there as it goes instead of building the whole output
+    QString savePath;
+    if (!toClipboard) {
+        // Create a default filename
+        QString defaultFileName = QFileInfo(currentPath).fileName() + "_processed.txt";
+        QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
+        QString defaultFilePath = QDir(defaultPath).filePath(defaultFileName);
+
+        // Compressed formats are offered when the build has their library
+        QStringList filters = {"Text Files (*.txt)", "Markdown Files (*.md)"};
+        filters << BlockCompressor::fileFilters() << "All Files (*.*)";
+        savePath = QFileDialog::getSaveFileName(
+            this,
+            "Save Processed Code",
+            defaultFilePath,
+            filters.join(";;")
+        );
+        if (savePath.isEmpty()) {
+            return;
+        }
+    }
+
     // Create processing dialog
     auto* dialog = new ProcessingDialog(this);
     dialog->setWindowTitle(toClipboard ? "Copying to Clipboard" : "Saving to File");
@@ -356,23 +541,29 @@ void MainWindow::startFileProcessing(bool toClipboard)
     qApp->processEvents();
 
     // Create worker thread with enhanced safety
-    auto* worker = new FileProcessingWorker(currentPath, filesToProcess, fileModel);
+    // The worker reads a copy; the tree keeps following the filesystem
+    auto* worker = new FileProcessingWorker(
+        QSharedPointer<const ScanSnapshot>::create(*scanSnapshot), filesToProcess);
+    worker->setOutputPath(savePath);
+    if (!contentCache && config.getContentCacheMB() > 0) {
+        contentCache = QSharedPointer<ContentCache>::create(
+            qint64(config.getContentCacheMB()) * 1024 * 1024,
+            qint64(config.getContentCacheSpillMB()) * 1024 * 1024);
+    }
+    worker->setContentCache(contentCache);
     workerThread = new QThread(this);
     worker->moveToThread(workerThread);
+    exportControl = worker->control();
 
-    // Connect signals with error handling
-    connect(worker, &FileProcessingWorker::processingProgress, 
-            dialog, &ProcessingDialog::setProgress);
-    connect(worker, &FileProcessingWorker::currentFile,
-            dialog, &ProcessingDialog::setCurrentFile);
-    connect(worker, &FileProcessingWorker::statistics,
-            dialog, &ProcessingDialog::updateStatistics);
+    // Progress is sampled by the dialog; only the outcome is signalled
+    const QSharedPointer<const ProcessingProgress> progress = worker->progress();
+    dialog->watch(progress, exportControl);
 
     // Handle successful completion
     connect(worker, &FileProcessingWorker::finished, this, 
-        [this, dialog, worker, toClipboard, processableFilesCount](const QString& result) {
+        [this, dialog, worker, progress, toClipboard, processableFilesCount](const ExportRope& result) {
             // Ensure UI updates happen on main thread
-            QMetaObject::invokeMethod(this, [this, dialog, worker, toClipboard, result, processableFilesCount]() {
+            QMetaObject::invokeMethod(this, [this, dialog, worker, progress, toClipboard, result, processableFilesCount]() {
                 // Clean up dialog first
                 dialog->hide();
                 dialog->deleteLater();
@@ -389,9 +580,64 @@ void MainWindow::startFileProcessing(bool toClipboard)
 
                 // Get the final statistics
                 int actualProcessedFiles = dialog->processedFiles();
-                QString totalSize = dialog->formatFileSize(dialog->totalSize());
+                QString totalSize = QString("%1 (~%2 tokens)")
+                    .arg(dialog->formatFileSize(dialog->totalSize()))
+                    .arg(QLocale().toString(dialog->tokens()));
+                if (dialog->overBudgetFiles() > 0) {
+                    totalSize += QString("\nLeft out for the token budget: %1 files")
+                        .arg(dialog->overBudgetFiles());
+                }
+                if (dialog->binaryFiles() > 0) {
+                    totalSize += QString("\nBinary files skipped: %1 (%2 not read)")
+                        .arg(dialog->binaryFiles())
+                        .arg(dialog->formatFileSize(dialog->bytesNotRead()));
+                }
+                if (dialog->duplicateFiles() > 0) {
+                    totalSize += QString("\nDuplicate files: %1 (%2 saved)")
+                        .arg(dialog->duplicateFiles())
+                        .arg(dialog->formatFileSize(dialog->bytesDeduplicated()));
+                }
+                if (dialog->truncatedFiles() > 0) {
+                    totalSize += QString("\nLarge files cut to their first and last lines: %1")
+                        .arg(dialog->truncatedFiles());
+                }
+                if (dialog->bytesStripped() > 0) {
+                    totalSize += QString("\nComments and blank space stripped: %1")
+                        .arg(dialog->formatFileSize(dialog->bytesStripped()));
+                }
+                // Safe to read now: the worker is done with these lists
+                const QVector<qint64>& fileTokens = progress->fileTokens;
+                std::vector<int> exported;
+                for (int i = 0; i < fileTokens.size(); ++i) {
+                    if (fileTokens[i] > 0) {
+                        exported.push_back(i);
+                    }
+                }
+                constexpr size_t kLargestFiles = 5;
+                const size_t listed = std::min(kLargestFiles, exported.size());
+                std::partial_sort(exported.begin(), exported.begin() + static_cast<std::ptrdiff_t>(listed),
+                                  exported.end(),
+                                  [&fileTokens](int a, int b) { return fileTokens[a] > fileTokens[b]; });
+                if (listed > 0) {
+                    totalSize += "\nMost tokens:";
+                    for (size_t i = 0; i < listed; ++i) {
+                        totalSize += QString("\n  %1 (~%2)")
+                            .arg(progress->files[exported[i]])
+                            .arg(QLocale().toString(fileTokens[exported[i]]));
+                    }
+                }
+                const QStringList& repairedPaths = progress->repairedPaths;
+                if (!repairedPaths.isEmpty()) {
+                    constexpr int kListedFiles = 5;
+                    totalSize += QString("\nInvalid UTF-8 replaced in %1 files:\n  %2")
+                        .arg(repairedPaths.size())
+                        .arg(repairedPaths.mid(0, kListedFiles).join("\n  "));
+                    if (repairedPaths.size() > kListedFiles) {
+                        totalSize += QString("\n  ... and %1 more").arg(repairedPaths.size() - kListedFiles);
+                    }
+                }
 
-                if (result.isEmpty()) {
+                if (toClipboard && result.isEmpty()) {
                     QMessageBox::warning(this, "Processing Result", 
                                        "No content was processed. Please check your file selection.");
                     return;
@@ -399,13 +645,15 @@ void MainWindow::startFileProcessing(bool toClipboard)
 
                 if (toClipboard) {
                     QClipboard* clipboard = QApplication::clipboard();
+
+                    // The clipboard is the one consumer that needs UTF-16;
+                    // the text is only rendered when something pastes it
+                    clipboard->setMimeData(new RopeMimeData(result), QClipboard::Clipboard);
                     
-                    // Set text in the regular clipboard
-                    clipboard->setText(result, QClipboard::Clipboard);
-                    
-                    // Also set it in the X11 primary selection for Linux
+                    // Also set it in the X11 primary selection for Linux,
+                    // sharing the same chunks
                     if (clipboard->supportsSelection()) {
-                        clipboard->setText(result, QClipboard::Selection);
+                        clipboard->setMimeData(new RopeMimeData(result), QClipboard::Selection);
                     }
                     
                     // Force event processing to ensure clipboard content is properly set
@@ -416,41 +664,16 @@ void MainWindow::startFileProcessing(bool toClipboard)
                                 "Files processed: %1\nTotal size: %2")
                         .arg(actualProcessedFiles).arg(totalSize));
                 } else {
-                    // Create a default filename
-                    QString defaultFileName = QFileInfo(currentPath).fileName() + "_processed.txt";
-                    QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
-                    QString defaultFilePath = QDir(defaultPath).filePath(defaultFileName);
-
-                    QString savePath = QFileDialog::getSaveFileName(
-                        this,
-                        "Save Processed Code",
-                        defaultFilePath,
-                        "Text Files (*.txt);;Markdown Files (*.md);;All Files (*.*)"
-                    );
-
-                    if (!savePath.isEmpty()) {
-                        QFile file(savePath);
-                        
-                        if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-                            // Set file permissions after opening
-                            file.setPermissions(QFile::ReadOwner | QFile::WriteOwner |
-                                              QFile::ReadUser | QFile::WriteUser |
-                                              QFile::ReadGroup | QFile::ReadOther);
-                            // Write UTF-8 BOM
-                            file.write("\xEF\xBB\xBF");
-                            // Write content as UTF-8
-                            file.write(result.toUtf8());
-                            file.flush();
-                            file.close();
-                            QMessageBox::information(this, "Success",
-                                QString("Files successfully processed and saved!\n\n"
-                                        "Files processed: %1\nTotal size: %2")
-                                .arg(actualProcessedFiles).arg(totalSize));
-                        } else {
-                            QMessageBox::critical(this, "Error",
-                                "Could not save the file: " + file.errorString());
-                        }
+                    // The worker already wrote and committed the file
+                    if (!progress->manifestPath.isEmpty()) {
+                        totalSize += QString("\nSplit into %1 parts, listed in %2")
+                            .arg(progress->shardFiles.load(std::memory_order_relaxed))
+                            .arg(QFileInfo(progress->manifestPath).fileName());
                     }
+                    QMessageBox::information(this, "Success",
+                        QString("Files successfully processed and saved!\n\n"
+                                "Files processed: %1\nTotal size: %2")
+                        .arg(actualProcessedFiles).arg(totalSize));
                 }
 
                 dialog->deleteLater();
@@ -482,6 +705,26 @@ void MainWindow::startFileProcessing(bool toClipboard)
         }
     );
 
+    // Handle cancellation from the dialog; nothing was saved or copied
+    connect(worker, &FileProcessingWorker::cancelled, this,
+        [this, dialog, worker]() {
+            QMetaObject::invokeMethod(this, [this, dialog, worker]() {
+                dialog->hide();
+                dialog->deleteLater();
+
+                worker->deleteLater();
+                if (workerThread) {
+                    workerThread->quit();
+                    connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
+                    connect(workerThread, &QThread::finished, [this]() {
+                        workerThread = nullptr;
+                    });
+                }
+                qDebug() << "Export cancelled";
+            });
+        }
+    );
+
     // Ensure proper cleanup if thread fails to start
     connect(workerThread, &QThread::finished, worker, &QObject::deleteLater);
     connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
@@ -511,6 +754,22 @@ void MainWindow::startFileProcessing(bool toClipboard)
     }
 }
 
+void MainWindow::stopFileProcessing()
+{
+    if (!workerThread || !workerThread->isRunning()) {
+        return;
+    }
+
+    // The worker checks the control between files and between chunks of a
+    // file, so it returns promptly even mid-file or paused; quit() alone
+    // would wait for process() to run to the end
+    if (exportControl) {
+        exportControl->cancel();
+    }
+    workerThread->quit();
+    workerThread->wait();
+}
+
 void MainWindow::saveToClipboard()
 {
     startFileProcessing(true);
@@ -539,14 +798,7 @@ void MainWindow::closeEvent(QCloseEvent* event)
             return;
         }
         
-        // Attempt to stop the thread
-        workerThread->quit();
-        
-        // Wait for the thread to terminate
-        if (!workerThread->wait(2000)) { // Wait up to 2 seconds
-            qWarning() << "Worker thread did not terminate gracefully. Attempting to terminate.";
-            workerThread->terminate(); // Last resort
-        }
+        stopFileProcessing();
     }
 
     // Cleanup any remaining resources
@@ -555,13 +807,16 @@ void MainWindow::closeEvent(QCloseEvent* event)
         fileModel = nullptr;
     }
 
-    if (gitignoreWatcher) {
-        delete gitignoreWatcher;
-        gitignoreWatcher = nullptr;
+    if (changeTracker) {
+        delete changeTracker;
+        changeTracker = nullptr;
     }
 
-    // Clear selected files
-    selectedFiles.clear();
+    // Keep what incremental updates did for the next start
+    if (scanSnapshot && scanIndexDirty) {
+        ScanIndex::save(scanSnapshot->compacted());
+        scanIndexDirty = false;
+    }
 
     // Accept the close event
     event->accept();
@@ -4,17 +4,22 @@
 
 #include <QMainWindow>
 #include <QString>
-#include <set>
+#include <QStringList>
+#include <QSharedPointer>
+#include "ChangeTracker.h"
 #include <QCloseEvent>  // Add this include
 
 // Forward declarations to reduce header dependencies
 class QTreeView;
 class QPushButton;
 class QVBoxLayout;
-class QFileSystemWatcher;
-class FileSystemModelWithGitIgnore;
+class ScanTreeModel;
 class ProcessingDialog;
-class QItemSelection;
+class ParallelTreeWalker;
+class FilterEngine;
+class ScanSnapshot;
+class ExportControl;
+class ContentCache;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -31,16 +36,19 @@ private slots:
     void selectFolder();
     void saveToFile();
     void saveToClipboard();
-    void onGitIgnoreChanged();
-    void handleSelectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
+    void onFilesystemChanged(const ChangeSet& changes);
 
 private:
     void delayedInit();
     void setupUI();
-    void expandDirectory(const QModelIndex& index, int depth);
     QString processFiles();
     void selectAllProcessableFiles(const QModelIndex& parentIndex);
-    void expandEntireDirectoryTree(const QModelIndex& parentIndex, int depth = 0);
+    void onScanFinished();
+    void applyChanges(const ChangeSet& changes);
+    void updateModifiedFile(const QString& relativePath);
+    void onChangesScanned();
+    void saveScanIndex();
+    void showScannedTree();
     void updateFileSelection(const QString& filePath, bool selected);
 
     // UI Elements
@@ -52,10 +60,19 @@ private:
     QPushButton *saveClipboardButton{nullptr};
     
     // Model and data handling
-    FileSystemModelWithGitIgnore *fileModel{nullptr};
-    QFileSystemWatcher *gitignoreWatcher{nullptr};
+    ScanTreeModel *fileModel{nullptr};
+    QSharedPointer<const FilterEngine> filterEngine;
+    QSharedPointer<ScanSnapshot> scanSnapshot;
+    ChangeTracker *changeTracker{nullptr};
+    ChangeSet pendingChanges;
+    bool scanIndexDirty{false};
+    ParallelTreeWalker *treeWalker{nullptr};
+    int scanGeneration{0};
     QString currentPath;
-    std::set<QString> selectedFiles;
     QThread* workerThread{nullptr};
+    QSharedPointer<ExportControl> exportControl;
+    // Outlives exports, so the next one only reads files that changed
+    QSharedPointer<ContentCache> contentCache;
     void startFileProcessing(bool toClipboard);
+    void stopFileProcessing();
 };
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include "ParallelTreeWalker.h"
+#include "WorkStealingThreadPool.h"
+#include <QDir>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace {
+// Record layout returned by getdents64(2); glibc does not export it
+struct LinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+}
+#endif
+
+ParallelTreeWalker::ParallelTreeWalker(const QSharedPointer<const FilterEngine>& engine,
+                                       QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+    , m_rootPath(engine->rootPath()) {
+}
+
+ParallelTreeWalker::~ParallelTreeWalker() {
+    cancel();
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void ParallelTreeWalker::start() {
+    if (m_thread) {
+        return;
+    }
+    m_thread = QThread::create([this]() { walk(); });
+    m_thread->start();
+}
+
+void ParallelTreeWalker::walk() {
+    QElapsedTimer timer;
+    timer.start();
+
+    {
+        WorkStealingThreadPool pool(m_threadCount);
+        m_pool = &pool;
+        if (m_scope.empty()) {
+            pool.submit([this]() { scanDirectory(QString(), m_engine->rootIgnoreStack(), true); });
+        }
+        for (const auto& scope : m_scope) {
+            pool.submit([this, scope]() { scanScope(scope.first, scope.second); });
+        }
+        pool.waitForDone();
+        m_pool = nullptr;
+    }
+    flush();
+
+    // A limited walk leaves its listings for takeListings()
+    if (m_scope.empty()) {
+        if (!m_cancelled) {
+            m_snapshot = QSharedPointer<ScanSnapshot>::create(
+                ScanSnapshot::build(m_rootPath, std::move(m_listings)));
+        }
+        m_listings.clear();
+    } else if (m_cancelled) {
+        m_listings.clear();
+    }
+
+    qDebug() << "Scanned" << m_directoriesScanned.load() << "directories"
+             << "(" << m_directoriesReused.load() << "unchanged since the last scan) in"
+             << timer.elapsed() << "ms," << m_filesAccepted.load() << "files accepted";
+    emit finished(m_directoriesScanned.load(), m_filesAccepted.load());
+}
+
+void ParallelTreeWalker::scanScope(const QString& relativeDir, bool recursive) {
+    if (relativeDir.isEmpty()) {
+        scanDirectory(relativeDir, m_engine->rootIgnoreStack(), recursive);
+        return;
+    }
+
+    // The rules may have changed since the directory was listed; if it is
+    // now excluded, the listing of an ancestor drops it
+    qsizetype slash = relativeDir.lastIndexOf('/');
+    GitIgnoreStack parentStack;
+    if (m_engine->checkAncestors(slash == -1 ? QStringView() : QStringView(relativeDir).left(slash),
+                                 parentStack) == FilterEngine::Verdict::Accepted &&
+        m_engine->checkDirectory(relativeDir, parentStack) == FilterEngine::Verdict::Accepted) {
+        scanDirectory(relativeDir, parentStack, recursive);
+    }
+}
+
+void ParallelTreeWalker::scanDirectory(const QString& relativeDir, const GitIgnoreStack& parentStack,
+                                       bool recursive) {
+    if (m_cancelled) {
+        return;
+    }
+
+    QString dirPath = relativeDir.isEmpty() ? m_rootPath : m_rootPath + '/' + relativeDir;
+    ScanEntry directory;
+    if (!statEntry(dirPath, directory)) {
+        qWarning() << "Could not read directory:" << dirPath;
+        return;
+    }
+
+    ScanListing listing;
+    listing.relativeDir = relativeDir;
+    listing.mtime = directory.mtime;
+    listing.inode = directory.inode;
+
+    // An unchanged directory mtime means no entry was added, removed or renamed
+    int previousNode = m_previous ? m_previous->findDirectory(relativeDir) : -1;
+    bool reused = previousNode >= 0 && listing.mtime != 0 &&
+                  m_previous->mtime(previousNode) == listing.mtime &&
+                  m_previous->inode(previousNode) == listing.inode;
+    if (reused) {
+        listing.entries = m_previous->entries(previousNode);
+        listing.hasIgnoreFile = m_previous->flags(previousNode) & ScanSnapshot::HasIgnoreFile;
+        ++m_directoriesReused;
+    } else if (!readDirectory(dirPath, listing.entries, listing.hasIgnoreFile)) {
+        qWarning() << "Could not read directory:" << dirPath;
+        return;
+    }
+    ++m_directoriesScanned;
+
+    // The root stack already holds the root .gitignore
+    GitIgnoreStack ignoreStack = (relativeDir.isEmpty() || !listing.hasIgnoreFile)
+        ? parentStack
+        : parentStack.enterDirectory(relativeDir);
+
+    QStringList accepted;
+    for (ScanEntry& entry : listing.entries) {
+        QString relativePath = relativeDir.isEmpty() ? entry.name : relativeDir + '/' + entry.name;
+
+        if (entry.isDir) {
+            entry.verdict = m_engine->checkDirectory(relativePath, ignoreStack);
+            // Outside a recursive scope, known directories are left alone
+            bool known = !recursive && m_previous && m_previous->findDirectory(relativePath) >= 0;
+            if (entry.verdict == FilterEngine::Verdict::Accepted && !known) {
+                m_pool->submit([this, relativePath, ignoreStack, recursive]() {
+                    scanDirectory(relativePath, ignoreStack, recursive);
+                });
+            }
+            continue;
+        }
+
+        // Name checks are free; only survivors are stat'ed for their size,
+        // and not even those when the directory is unchanged, unless asked to
+        entry.verdict = m_engine->checkFileName(relativePath, ignoreStack);
+        if (entry.verdict != FilterEngine::Verdict::Accepted) {
+            continue;
+        }
+        QString filePath = m_rootPath + '/' + relativePath;
+        if ((!reused || m_restatFiles || entry.size < 0) && !statEntry(filePath, entry)) {
+            entry.verdict = FilterEngine::Verdict::NotReadable;
+            continue;
+        }
+        entry.verdict = entry.isRegularFile() ? m_engine->checkFileSize(entry.size)
+                                              : FilterEngine::Verdict::NotReadable;
+        if (entry.verdict == FilterEngine::Verdict::Accepted) {
+            accepted.append(filePath);
+        }
+    }
+
+    if (!accepted.isEmpty()) {
+        report(accepted);
+    }
+
+    QMutexLocker locker(&m_batchMutex);
+    m_listings.push_back(std::move(listing));
+}
+
+bool ParallelTreeWalker::readDirectory(const QString& dirPath,
+                                       std::vector<ScanEntry>& entries,
+                                       bool& hasIgnoreFile) const {
+#ifdef Q_OS_LINUX
+    int fd = ::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    alignas(LinuxDirent64) char buffer[32 * 1024];
+    for (;;) {
+        long bytes = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+            offset += dirent->d_reclen;
+            const char* name = dirent->d_name;
+
+            // Hidden entries are listed, as the tree showed them with
+            // QDir::Hidden, so .github/ or .clang-format can be exported;
+            // the ignore rules decide about the rest. Only . and .. and the
+            // repository itself are left out.
+            if (name[0] == '.') {
+                if (name[1] == '\0' || (name[1] == '.' && name[2] == '\0') || std::strcmp(name, ".git") == 0) {
+                    continue;
+                }
+                if (std::strcmp(name, ".gitignore") == 0) {
+                    hasIgnoreFile = true;
+                }
+            }
+
+            unsigned char type = dirent->d_type;
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                // Some filesystems do not fill d_type; symlinks to files are
+                // followed, symlinks to directories are not
+                struct stat st;
+                int flags = type == DT_LNK ? 0 : AT_SYMLINK_NOFOLLOW;
+                if (::fstatat(fd, name, &st, flags) != 0) {
+                    continue;
+                }
+                if (S_ISREG(st.st_mode)) {
+                    type = DT_REG;
+                } else if (S_ISDIR(st.st_mode) && dirent->d_type != DT_LNK) {
+                    type = DT_DIR;
+                } else {
+                    continue;
+                }
+            }
+
+            if (type == DT_DIR || type == DT_REG) {
+                ScanEntry entry;
+                entry.name = QFile::decodeName(name);
+                entry.isDir = type == DT_DIR;
+                entry.inode = dirent->d_ino;
+                entries.push_back(std::move(entry));
+            }
+        }
+    }
+
+    ::close(fd);
+    return true;
+#else
+    QDir dir(dirPath);
+    if (!dir.exists()) {
+        return false;
+    }
+    hasIgnoreFile = QFileInfo::exists(dirPath + "/.gitignore");
+
+    const QFileInfoList infos = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+    entries.reserve(infos.size());
+    for (const QFileInfo& info : infos) {
+        if ((info.isDir() && info.isSymLink()) || info.fileName() == ".git") {
+            continue;
+        }
+        ScanEntry entry;
+        entry.name = info.fileName();
+        entry.isDir = info.isDir();
+        entries.push_back(std::move(entry));
+    }
+    return true;
+#endif
+}
+
+bool ParallelTreeWalker::statEntry(const QString& path, ScanEntry& entry) {
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return false;
+    }
+    entry.size = st.st_size;
+    entry.mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    entry.inode = st.st_ino;
+    entry.mode = st.st_mode;
+    return true;
+#else
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return false;
+    }
+    entry.size = info.size();
+    entry.mtime = info.lastModified().toMSecsSinceEpoch() * 1000000;
+    return true;
+#endif
+}
+
+void ParallelTreeWalker::report(const QStringList& filePaths) {
+    m_filesAccepted += filePaths.size();
+
+    QStringList ready;
+    {
+        QMutexLocker locker(&m_batchMutex);
+        m_batch += filePaths;
+        if (m_batch.size() < m_batchSize) {
+            return;
+        }
+        ready.swap(m_batch);
+    }
+    emit filesFound(ready);
+}
+
+void ParallelTreeWalker::flush() {
+    QStringList ready;
+    {
+        QMutexLocker locker(&m_batchMutex);
+        ready.swap(m_batch);
+    }
+    if (!ready.isEmpty() && !m_cancelled) {
+        emit filesFound(ready);
+    }
+}
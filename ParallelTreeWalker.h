@@ -0,0 +1,96 @@
+// ParallelTreeWalker.h
+#pragma once
+
+#include <QObject>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <utility>
+#include <vector>
+#include "FilterEngine.h"
+#include "ScanSnapshot.h"
+
+class QThread;
+class WorkStealingThreadPool;
+
+// Enumerates a directory tree on a work-stealing thread pool.
+//
+// Every directory is one task; reading it schedules a task per subdirectory
+// that the FilterEngine accepts, so excluded trees are never opened. On Linux
+// directories are read with getdents64 and the entry type comes from d_type,
+// so no entry is stat'ed just to learn whether it is a directory. Accepted
+// files are streamed back in batches through filesFound().
+//
+// Given the snapshot of an earlier scan, a directory whose mtime and inode
+// are unchanged is not read again: its entries, sizes and mtimes are taken
+// from the snapshot and only the (cheap) filter verdicts are recomputed.
+// Editing a file doesn't move its directory's mtime, so walks that follow
+// up on changes can have the files stat'ed again all the same.
+//
+// A walk can also be limited to a few directories, e.g. the ones a
+// ChangeTracker reported. Such a walk does not build a snapshot; its listings
+// are meant to be applied to the previous one with ScanSnapshot::applyListing.
+class ParallelTreeWalker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ParallelTreeWalker(const QSharedPointer<const FilterEngine>& engine,
+                                QObject* parent = nullptr);
+    ~ParallelTreeWalker() override;
+
+    void setThreadCount(int count) { m_threadCount = count; }
+    void setBatchSize(int size) { m_batchSize = size; }
+    void setPreviousSnapshot(const QSharedPointer<const ScanSnapshot>& snapshot) { m_previous = snapshot; }
+    // Stats accepted files even in directories whose entries are reused
+    void setRestatFiles(bool restat) { m_restatFiles = restat; }
+    // Limits the walk to relativeDir. Subdirectories known to the previous
+    // snapshot are only entered when recursive is set; new ones always are.
+    void addScope(const QString& relativeDir, bool recursive) { m_scope.emplace_back(relativeDir, recursive); }
+
+    // Walk on a background thread; results arrive through the signals
+    void start();
+    // Walk and block until done; signals are emitted from pool threads
+    void walk();
+    void cancel() { m_cancelled = true; }
+
+    // Everything seen by the last walk, available once finished() was emitted
+    QSharedPointer<ScanSnapshot> snapshot() const { return m_snapshot; }
+    // Directories read by the last limited walk, in no particular order
+    std::vector<ScanListing> takeListings() { return std::move(m_listings); }
+
+    // Fills size, mtime (in nanoseconds) and inode
+    static bool statEntry(const QString& path, ScanEntry& entry);
+
+signals:
+    void filesFound(const QStringList& filePaths);
+    void finished(int directoriesScanned, int filesAccepted);
+
+private:
+    void scanScope(const QString& relativeDir, bool recursive);
+    void scanDirectory(const QString& relativeDir, const GitIgnoreStack& parentStack, bool recursive);
+    bool readDirectory(const QString& dirPath, std::vector<ScanEntry>& entries, bool& hasIgnoreFile) const;
+    void report(const QStringList& filePaths);
+    void flush();
+
+    QSharedPointer<const FilterEngine> m_engine;
+    QSharedPointer<const ScanSnapshot> m_previous;
+    QSharedPointer<ScanSnapshot> m_snapshot;
+    QString m_rootPath;
+    std::vector<std::pair<QString, bool>> m_scope;
+    int m_threadCount = 0;
+    int m_batchSize = 512;
+    bool m_restatFiles = false;
+
+    WorkStealingThreadPool* m_pool = nullptr;
+    QThread* m_thread = nullptr;
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<int> m_directoriesScanned{0};
+    std::atomic<int> m_directoriesReused{0};
+    std::atomic<int> m_filesAccepted{0};
+
+    QMutex m_batchMutex;
+    QStringList m_batch;
+    std::vector<ScanListing> m_listings;
+};
@@ -1,8 +1,16 @@
 #include "ProcessingDialog.h"
 #include <QVBoxLayout>
+#include <QHBoxLayout>
 #include <QProgressBar>
+#include <QPushButton>
 #include <QLabel>
-#include <QDebug>
+#include <QLocale>
+#include <QTimer>
+
+namespace {
+// Fast enough to look live, slow enough to cost nothing at any file rate
+constexpr int kPollIntervalMs = 33;
+}
 
 ProcessingDialog::ProcessingDialog(QWidget* parent) 
     : QDialog(parent, Qt::Dialog | Qt::CustomizeWindowHint | Qt::WindowTitleHint) {
@@ -34,19 +42,160 @@ ProcessingDialog::ProcessingDialog(QWidget* parent)
     progressBar->setTextVisible(true);
     mainLayout->addWidget(progressBar);
 
+    // Pause and cancel only flip flags the worker checks between chunks
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    buttonLayout->addStretch();
+    pauseButton = new QPushButton("Pause", this);
+    cancelButton = new QPushButton("Cancel", this);
+    pauseButton->setEnabled(false);
+    cancelButton->setEnabled(false);
+    buttonLayout->addWidget(pauseButton);
+    buttonLayout->addWidget(cancelButton);
+    mainLayout->addLayout(buttonLayout);
+    connect(pauseButton, &QPushButton::clicked, this, &ProcessingDialog::togglePause);
+    connect(cancelButton, &QPushButton::clicked, this, &ProcessingDialog::reject);
+
     // Set a reasonable size for the dialog
-    setFixedSize(500, 200);
+    setFixedSize(500, 300);
     setWindowTitle("Processing");
+
+    pollTimer = new QTimer(this);
+    pollTimer->setInterval(kPollIntervalMs);
+    connect(pollTimer, &QTimer::timeout, this, &ProcessingDialog::poll);
 }
 
-void ProcessingDialog::setProgress(int current, int total) {
-    if (total <= 0) return;
-    
-    int percentage = (current * 100) / total;
-    progressBar->setValue(percentage);
-    messageLabel->setText(QString("Processing files... (%1 of %2)").arg(current).arg(total));
-    
-    qDebug() << "Progress:" << current << "of" << total;
+void ProcessingDialog::watch(const QSharedPointer<const ProcessingProgress>& progress,
+                             const QSharedPointer<ExportControl>& control) {
+    m_progress = progress;
+    m_control = control;
+    m_shownFile = -1;
+    pauseButton->setEnabled(true);
+    cancelButton->setEnabled(true);
+    pollTimer->start();
+}
+
+void ProcessingDialog::reject() {
+    // Closing is up to whoever started the export, once it has stopped
+    if (!m_control || m_control->isCancelled()) {
+        return;
+    }
+    m_control->cancel();
+    pauseButton->setEnabled(false);
+    cancelButton->setEnabled(false);
+    messageLabel->setText("Cancelling...");
+}
+
+void ProcessingDialog::togglePause() {
+    if (!m_control || m_control->isCancelled()) {
+        return;
+    }
+    if (m_control->isPaused()) {
+        m_control->resume();
+        pauseButton->setText("Pause");
+    } else {
+        m_control->pause();
+        pauseButton->setText("Resume");
+    }
+}
+
+int ProcessingDialog::processedFiles() const {
+    return m_progress ? m_progress->processedFiles.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 ProcessingDialog::totalSize() const {
+    return m_progress ? m_progress->totalSize.load(std::memory_order_relaxed) : 0;
+}
+
+int ProcessingDialog::binaryFiles() const {
+    return m_progress ? m_progress->binaryFiles.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 ProcessingDialog::bytesNotRead() const {
+    return m_progress ? m_progress->bytesNotRead.load(std::memory_order_relaxed) : 0;
+}
+
+int ProcessingDialog::cachedFiles() const {
+    return m_progress ? m_progress->cachedFiles.load(std::memory_order_relaxed) : 0;
+}
+
+int ProcessingDialog::repairedFiles() const {
+    return m_progress ? m_progress->repairedFiles.load(std::memory_order_relaxed) : 0;
+}
+
+int ProcessingDialog::duplicateFiles() const {
+    return m_progress ? m_progress->duplicateFiles.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 ProcessingDialog::bytesDeduplicated() const {
+    return m_progress ? m_progress->bytesDeduplicated.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 ProcessingDialog::bytesStripped() const {
+    return m_progress ? m_progress->bytesStripped.load(std::memory_order_relaxed) : 0;
+}
+
+int ProcessingDialog::truncatedFiles() const {
+    return m_progress ? m_progress->truncatedFiles.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 ProcessingDialog::tokens() const {
+    return m_progress ? m_progress->tokens.load(std::memory_order_relaxed) : 0;
+}
+
+int ProcessingDialog::overBudgetFiles() const {
+    return m_progress ? m_progress->overBudgetFiles.load(std::memory_order_relaxed) : 0;
+}
+
+void ProcessingDialog::poll() {
+    // Nothing to show until the worker has published its file list
+    const int total = m_progress ? m_progress->totalFiles.load(std::memory_order_acquire) : -1;
+    if (total <= 0 || m_control->isCancelled()) {
+        return;
+    }
+
+    const int done = processedFiles() + binaryFiles() +
+                     m_progress->budgetSkippedFiles.load(std::memory_order_relaxed);
+    progressBar->setValue(static_cast<int>(qint64(done) * 100 / total));
+    messageLabel->setText(QString(m_control->isPaused() ? "Paused (%1 of %2)" : "Processing files... (%1 of %2)")
+                              .arg(done).arg(total));
+
+    // Only the file being appended right now, not every one since last time
+    const int current = m_progress->currentFile.load(std::memory_order_relaxed);
+    if (current >= 0 && current != m_shownFile) {
+        m_shownFile = current;
+        setCurrentFile(m_progress->files[current]);
+    }
+
+    QString text = QString("Files processed: %1\nTotal size: %2 (~%3 tokens)")
+        .arg(processedFiles())
+        .arg(formatFileSize(totalSize()))
+        .arg(QLocale().toString(tokens()));
+    if (overBudgetFiles() > 0) {
+        text += QString("\nLeft out for the token budget: %1").arg(overBudgetFiles());
+    }
+    if (binaryFiles() > 0) {
+        text += QString("\nBinary files skipped: %1 (%2 not read)")
+            .arg(binaryFiles())
+            .arg(formatFileSize(bytesNotRead()));
+    }
+    if (cachedFiles() > 0) {
+        text += QString("\nUnchanged since the last export: %1").arg(cachedFiles());
+    }
+    if (duplicateFiles() > 0) {
+        text += QString("\nDuplicate files: %1 (%2 saved)")
+            .arg(duplicateFiles())
+            .arg(formatFileSize(bytesDeduplicated()));
+    }
+    if (truncatedFiles() > 0) {
+        text += QString("\nLarge files truncated: %1").arg(truncatedFiles());
+    }
+    if (bytesStripped() > 0) {
+        text += QString("\nComments and blank space stripped: %1").arg(formatFileSize(bytesStripped()));
+    }
+    if (repairedFiles() > 0) {
+        text += QString("\nFiles with invalid UTF-8: %1").arg(repairedFiles());
+    }
+    statisticsLabel->setText(text);
 }
 
 void ProcessingDialog::setCurrentFile(const QString& filePath) {
@@ -61,8 +210,6 @@ void ProcessingDialog::setCurrentFile(const QString& filePath) {
     } else {
         currentFileLabel->setText(QString("Current file: %1").arg(displayPath));
     }
-    
-    qDebug() << "Processing file:" << filePath;
 }
 
 QString ProcessingDialog::formatFileSize(qint64 size) const {
@@ -79,13 +226,3 @@ QString ProcessingDialog::formatFileSize(qint64 size) const {
         .arg(fileSize, 0, 'f', unitIndex > 0 ? 2 : 0)
         .arg(units[unitIndex]);
 }
-
-void ProcessingDialog::updateStatistics(int processedFiles, qint64 totalSize) {
-    m_processedFiles = processedFiles;
-    m_totalSize = totalSize;
-    statisticsLabel->setText(QString("Files processed: %1\nTotal size: %2")
-        .arg(processedFiles)
-        .arg(formatFileSize(totalSize)));
-    
-    qDebug() << "Statistics update - Files:" << processedFiles << "Size:" << formatFileSize(totalSize);
-}
\ No newline at end of file
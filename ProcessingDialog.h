@@ -1,10 +1,15 @@
 #pragma once
 
 #include <QDialog>
+#include <QSharedPointer>
 #include <QString>
+#include "ExportControl.h"
+#include "ProcessingProgress.h"
 
 class QProgressBar;
+class QPushButton;
 class QLabel;
+class QTimer;
 class QVBoxLayout;
 
 class ProcessingDialog : public QDialog {
@@ -12,21 +17,44 @@ class ProcessingDialog : public QDialog {
 
 public:
     explicit ProcessingDialog(QWidget* parent = nullptr);
-    int processedFiles() const { return m_processedFiles; }
-    qint64 totalSize() const { return m_totalSize; }
+
+    // Shows progress from counters, sampled about 30 times a second; the
+    // buttons and Esc act on control
+    void watch(const QSharedPointer<const ProcessingProgress>& progress,
+               const QSharedPointer<ExportControl>& control);
+
+    int processedFiles() const;
+    qint64 totalSize() const;
+    int binaryFiles() const;
+    qint64 bytesNotRead() const;
+    int cachedFiles() const;
+    int repairedFiles() const;
+    int duplicateFiles() const;
+    qint64 bytesDeduplicated() const;
+    qint64 bytesStripped() const;
+    int truncatedFiles() const;
+    qint64 tokens() const;
+    int overBudgetFiles() const;
     QString formatFileSize(qint64 size) const;
 
 public slots:
-    void setProgress(int current, int total);
-    void setCurrentFile(const QString& filePath);
-    void updateStatistics(int processedFiles, qint64 totalSize);
+    // Cancels the export; the dialog stays up until the worker has stopped
+    void reject() override;
 
 private:
+    void poll();
+    void togglePause();
+    void setCurrentFile(const QString& filePath);
+
     QVBoxLayout* mainLayout;
     QLabel* messageLabel;
     QLabel* currentFileLabel;
     QLabel* statisticsLabel;
     QProgressBar* progressBar;
-    int m_processedFiles = 0;
-    qint64 m_totalSize = 0;
+    QPushButton* pauseButton;
+    QPushButton* cancelButton;
+    QTimer* pollTimer;
+    QSharedPointer<const ProcessingProgress> m_progress;
+    QSharedPointer<ExportControl> m_control;
+    int m_shownFile = -1;
 };
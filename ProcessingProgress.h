@@ -0,0 +1,44 @@
+// ProcessingProgress.h
+#pragma once
+
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+// Where an export stands, published by FileProcessingWorker and sampled by
+// ProcessingDialog on a timer. The worker only stores into the counters, so
+// it never waits for the UI however fast files go by.
+struct ProcessingProgress {
+    // Paths relative to the root, in output order. Written once by the
+    // worker before totalFiles is, and read only after totalFiles is seen.
+    QStringList files;
+    std::atomic<int> totalFiles{-1};     // -1 until files is filled in
+    std::atomic<int> currentFile{-1};    // index into files
+
+    std::atomic<int> processedFiles{0};
+    std::atomic<qint64> totalSize{0};
+    std::atomic<int> binaryFiles{0};
+    std::atomic<qint64> bytesNotRead{0};
+    std::atomic<int> cachedFiles{0};     // taken from the content cache
+    std::atomic<int> repairedFiles{0};   // had invalid UTF-8 replaced
+    std::atomic<int> duplicateFiles{0};  // exported as a reference instead
+    std::atomic<qint64> bytesDeduplicated{0};
+    std::atomic<qint64> bytesStripped{0}; // comments and blank space
+    std::atomic<int> truncatedFiles{0};  // exported as their two ends
+    std::atomic<qint64> tokens{0};       // estimated, of what was exported
+    std::atomic<int> overBudgetFiles{0}; // left out for the token budget
+    std::atomic<int> budgetSkippedFiles{0}; // of those, ones in files the export passed over
+    std::atomic<int> shardFiles{0};      // part files of a split export
+
+    // Estimated tokens per entry of files, -1 for files not exported.
+    // Complete once the worker has emitted finished().
+    QVector<qint64> fileTokens;
+
+    // Files counted in repairedFiles, in output order. Complete once the
+    // worker has emitted finished(); not to be read before that.
+    QStringList repairedPaths;
+
+    // The manifest of a split export, empty otherwise. Complete once the
+    // worker has emitted finished().
+    QString manifestPath;
+};
@@ -0,0 +1,32 @@
+#include "RopeMimeData.h"
+#include <QStringDecoder>
+
+RopeMimeData::RopeMimeData(const ExportRope& rope)
+    : m_rope(rope) {
+}
+
+QStringList RopeMimeData::formats() const {
+    return {QStringLiteral("text/plain"), QStringLiteral("text/plain;charset=utf-8")};
+}
+
+bool RopeMimeData::hasFormat(const QString& mimeType) const {
+    return formats().contains(mimeType);
+}
+
+QVariant RopeMimeData::retrieveData(const QString& mimeType, QMetaType type) const {
+    if (!hasFormat(mimeType)) {
+        return QVariant();
+    }
+    if (type.id() != QMetaType::QString) {
+        return m_rope.toByteArray();
+    }
+
+    // Decoded straight from the chunks, without a flat UTF-8 copy first
+    QString text;
+    text.reserve(static_cast<qsizetype>(m_rope.size()));
+    QStringDecoder decoder(QStringDecoder::Utf8);
+    for (const QByteArray& chunk : m_rope.chunks()) {
+        text += QString(decoder.decode(chunk));
+    }
+    return text;
+}
@@ -0,0 +1,28 @@
+// RopeMimeData.h
+#pragma once
+
+#include <QMimeData>
+#include "ExportRope.h"
+
+// Clipboard data that stays an ExportRope until it is pasted.
+//
+// QClipboard::setText() wants the whole output as a QString up front,
+// twice the UTF-8 size, and once more for the X11 selection. This offers
+// text/plain instead and renders it only when a paste asks for it: UTF-8
+// bytes when the platform takes those, a QString decoded chunk by chunk
+// otherwise. The clipboard and the selection share one rope.
+class RopeMimeData : public QMimeData {
+    Q_OBJECT
+
+public:
+    explicit RopeMimeData(const ExportRope& rope);
+
+    QStringList formats() const override;
+    bool hasFormat(const QString& mimeType) const override;
+
+protected:
+    QVariant retrieveData(const QString& mimeType, QMetaType type) const override;
+
+private:
+    const ExportRope m_rope;
+};
@@ -0,0 +1,199 @@
+#include "ScanIndex.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'B', 'P', 'I', 'D', 'X', '\0', '\0'};
+// 3: listings include hidden entries, so older ones can't be reused
+constexpr quint32 kVersion = 3;
+
+struct IndexHeader {
+    char magic[8];
+    quint32 version;
+    quint32 nodeCount;
+    quint32 childListCount;
+    quint32 namesSize;
+    quint32 rootPathSize;
+    quint32 reserved;
+};
+
+qint64 alignedSize(qint64 size) {
+    return (size + 7) & ~qint64(7);
+}
+
+bool writePadded(QSaveFile& file, const char* data, qint64 size) {
+    static const char padding[8] = {};
+    return file.write(data, size) == size &&
+           file.write(padding, alignedSize(size) - size) == alignedSize(size) - size;
+}
+
+template <typename T>
+bool writeColumn(QSaveFile& file, const std::vector<T>& column) {
+    return writePadded(file, reinterpret_cast<const char*>(column.data()),
+                       static_cast<qint64>(column.size() * sizeof(T)));
+}
+
+// Reads columns out of the mapped file, refusing to run past its end
+class ColumnReader {
+public:
+    ColumnReader(const uchar* data, qint64 size) : m_data(data), m_size(size) {}
+
+    // Whether bytes more are there; checked before anything is allocated
+    bool fits(qint64 bytes) const {
+        return m_offset + alignedSize(bytes) <= m_size;
+    }
+
+    bool read(void* target, qint64 bytes) {
+        if (!fits(bytes)) {
+            return false;
+        }
+        if (bytes > 0) {
+            std::memcpy(target, m_data + m_offset, static_cast<size_t>(bytes));
+        }
+        m_offset += alignedSize(bytes);
+        return true;
+    }
+
+    template <typename T>
+    bool read(std::vector<T>& column, quint32 count) {
+        const qint64 bytes = static_cast<qint64>(count) * qint64(sizeof(T));
+        if (!fits(bytes)) {
+            return false;
+        }
+        column.resize(count);
+        return read(column.data(), bytes);
+    }
+
+    bool read(QByteArray& bytes, quint32 size) {
+        if (!fits(size)) {
+            return false;
+        }
+        bytes.resize(static_cast<qsizetype>(size));
+        return read(bytes.data(), size);
+    }
+
+private:
+    const uchar* m_data;
+    qint64 m_size;
+    qint64 m_offset = 0;
+};
+
+} // namespace
+
+QString ScanIndex::indexPath(const QString& rootPath) {
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QByteArray key = QCryptographicHash::hash(rootPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(cacheDir).filePath("scan-index/" + QString::fromLatin1(key) + ".idx");
+}
+
+QSharedPointer<ScanSnapshot> ScanIndex::load(const QString& rootPath) {
+    QFile file(indexPath(rootPath));
+    if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(IndexHeader))) {
+        return {};
+    }
+
+    const qint64 fileSize = file.size();
+    const uchar* data = file.map(0, fileSize);
+    if (!data) {
+        return {};
+    }
+
+    IndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        qDebug() << "Ignoring scan index with unknown format:" << file.fileName();
+        return {};
+    }
+
+    auto snapshot = QSharedPointer<ScanSnapshot>::create();
+    ColumnReader reader(data + sizeof(IndexHeader), fileSize - qint64(sizeof(IndexHeader)));
+    const quint32 nodes = header.nodeCount;
+
+    QByteArray storedRoot;
+    bool ok = reader.read(storedRoot, header.rootPathSize)
+        && reader.read(snapshot->m_parent, nodes)
+        && reader.read(snapshot->m_row, nodes)
+        && reader.read(snapshot->m_childBegin, nodes)
+        && reader.read(snapshot->m_childCount, nodes)
+        && reader.read(snapshot->m_nameOffset, nodes)
+        && reader.read(snapshot->m_nameLength, nodes)
+        && reader.read(snapshot->m_size, nodes)
+        && reader.read(snapshot->m_mtime, nodes)
+        && reader.read(snapshot->m_inode, nodes)
+        && reader.read(snapshot->m_mode, nodes)
+        && reader.read(snapshot->m_flags, nodes)
+        && reader.read(snapshot->m_verdict, nodes)
+        && reader.read(snapshot->m_childList, header.childListCount)
+        && reader.read(snapshot->m_names, header.namesSize);
+    file.unmap(const_cast<uchar*>(data));
+
+    if (!ok || nodes == 0 || QString::fromUtf8(storedRoot) != rootPath) {
+        qDebug() << "Ignoring truncated or mismatched scan index:" << file.fileName();
+        return {};
+    }
+    // Everything that walks the tree trusts its links; a damaged file would
+    // have it read out of bounds or go round in circles
+    if (!snapshot->isWellFormed()) {
+        qDebug() << "Ignoring corrupt scan index:" << file.fileName();
+        return {};
+    }
+
+    snapshot->m_rootPath = rootPath;
+    snapshot->indexDirectories();
+    return snapshot;
+}
+
+bool ScanIndex::save(const ScanSnapshot& snapshot) {
+    if (snapshot.isEmpty()) {
+        return false;
+    }
+
+    QString path = indexPath(snapshot.rootPath());
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // QSaveFile renames into place on commit, so readers never see half a file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write scan index:" << path << file.errorString();
+        return false;
+    }
+
+    const QByteArray root = snapshot.rootPath().toUtf8();
+    IndexHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.nodeCount = static_cast<quint32>(snapshot.nodeCount());
+    header.childListCount = static_cast<quint32>(snapshot.m_childList.size());
+    header.namesSize = static_cast<quint32>(snapshot.m_names.size());
+    header.rootPathSize = static_cast<quint32>(root.size());
+
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header))
+        && writePadded(file, root.constData(), root.size())
+        && writeColumn(file, snapshot.m_parent)
+        && writeColumn(file, snapshot.m_row)
+        && writeColumn(file, snapshot.m_childBegin)
+        && writeColumn(file, snapshot.m_childCount)
+        && writeColumn(file, snapshot.m_nameOffset)
+        && writeColumn(file, snapshot.m_nameLength)
+        && writeColumn(file, snapshot.m_size)
+        && writeColumn(file, snapshot.m_mtime)
+        && writeColumn(file, snapshot.m_inode)
+        && writeColumn(file, snapshot.m_mode)
+        && writeColumn(file, snapshot.m_flags)
+        && writeColumn(file, snapshot.m_verdict)
+        && writeColumn(file, snapshot.m_childList)
+        && writePadded(file, snapshot.m_names.constData(), snapshot.m_names.size());
+
+    if (!ok || !file.commit()) {
+        qWarning() << "Could not write scan index:" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+// ScanIndex.h
+#pragma once
+
+#include <QSharedPointer>
+#include <QString>
+#include "ScanSnapshot.h"
+
+// Persistent copy of the last ScanSnapshot of a project root.
+//
+// One file per root under QStandardPaths::CacheLocation. The file is the
+// snapshot's columns written back to back behind a small header, each
+// 8-byte aligned, so loading is one mapping plus one copy per column.
+// Directory mtimes stored in the snapshot let the next scan skip every
+// directory that has not changed since.
+class ScanIndex {
+public:
+    static QString indexPath(const QString& rootPath);
+
+    // Null if there is no usable index for this root
+    static QSharedPointer<ScanSnapshot> load(const QString& rootPath);
+    static bool save(const ScanSnapshot& snapshot);
+};
@@ -0,0 +1,356 @@
+#include "ScanSnapshot.h"
+#include <algorithm>
+#include <cstring>
+
+ScanSnapshot ScanSnapshot::build(const QString& rootPath, std::vector<ScanListing> listings) {
+    ScanSnapshot snapshot;
+    snapshot.m_rootPath = rootPath;
+
+    QHash<QString, const ScanListing*> listingByDir;
+    listingByDir.reserve(static_cast<qsizetype>(listings.size()));
+    for (const ScanListing& listing : listings) {
+        listingByDir.insert(listing.relativeDir, &listing);
+    }
+
+    ScanEntry rootEntry;
+    rootEntry.isDir = true;
+    const ScanListing* rootListing = listingByDir.value(QString());
+    if (rootListing) {
+        rootEntry.mtime = rootListing->mtime;
+        rootEntry.inode = rootListing->inode;
+    }
+    snapshot.addNode(-1, rootEntry);
+
+    // Breadth first, so the children of every directory get neighbouring ids
+    std::vector<std::pair<int, const ScanListing*>> queue;
+    queue.emplace_back(0, rootListing);
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const int node = queue[i].first;
+        const ScanListing* listing = queue[i].second;
+        if (!listing) {
+            continue;
+        }
+
+        snapshot.m_flags[node] |= Listed;
+        if (listing->hasIgnoreFile) {
+            snapshot.m_flags[node] |= HasIgnoreFile;
+        }
+
+        std::vector<const ScanEntry*> ordered;
+        ordered.reserve(listing->entries.size());
+        for (const ScanEntry& entry : listing->entries) {
+            ordered.push_back(&entry);
+        }
+        snapshot.sortChildren(ordered);
+
+        snapshot.m_childBegin[node] = static_cast<qint32>(snapshot.m_childList.size());
+        snapshot.m_childCount[node] = static_cast<qint32>(ordered.size());
+
+        const QString prefix = listing->relativeDir.isEmpty() ? QString() : listing->relativeDir + '/';
+        for (const ScanEntry* entry : ordered) {
+            const int child = snapshot.addNode(node, *entry);
+            snapshot.m_childList.push_back(child);
+
+            if (entry->isDir) {
+                const ScanListing* subListing = listingByDir.value(prefix + entry->name);
+                if (subListing) {
+                    snapshot.m_mtime[child] = subListing->mtime;
+                    snapshot.m_inode[child] = subListing->inode;
+                    queue.emplace_back(child, subListing);
+                }
+            }
+        }
+    }
+
+    snapshot.indexDirectories();
+    return snapshot;
+}
+
+int ScanSnapshot::addNode(int parent, const ScanEntry& entry) {
+    const int node = nodeCount();
+    const QByteArray encodedName = entry.name.toUtf8();
+
+    m_parent.push_back(parent);
+    m_row.push_back(parent < 0 ? 0 : static_cast<qint32>(m_childList.size()) - m_childBegin[parent]);
+    m_childBegin.push_back(0);
+    m_childCount.push_back(0);
+    m_nameOffset.push_back(static_cast<quint32>(m_names.size()));
+    m_nameLength.push_back(static_cast<quint32>(encodedName.size()));
+    m_size.push_back(entry.size);
+    m_mtime.push_back(entry.mtime);
+    m_inode.push_back(entry.inode);
+    m_mode.push_back(entry.mode);
+    m_flags.push_back(entry.isDir ? IsDirectory : 0);
+    m_verdict.push_back(static_cast<quint8>(entry.verdict));
+
+    m_names.append(encodedName);
+    return node;
+}
+
+void ScanSnapshot::sortChildren(std::vector<const ScanEntry*>& entries) const {
+    // Same order as QFileSystemModel: directories first, then by name
+    std::sort(entries.begin(), entries.end(), [](const ScanEntry* a, const ScanEntry* b) {
+        if (a->isDir != b->isDir) {
+            return a->isDir;
+        }
+        int byName = a->name.compare(b->name, Qt::CaseInsensitive);
+        return byName != 0 ? byName < 0 : a->name < b->name;
+    });
+}
+
+void ScanSnapshot::indexDirectories() {
+    m_directories.clear();
+    for (int node = 0; node < nodeCount(); ++node) {
+        if (m_flags[node] & Listed) {
+            m_directories.insert(relativePath(node), node);
+        }
+    }
+}
+
+bool ScanSnapshot::isWellFormed() const {
+    const qint64 nodes = nodeCount();
+    if (nodes == 0 || m_parent[0] != -1 || !(m_flags[0] & IsDirectory)) {
+        return false;
+    }
+    const qint64 names = m_names.size();
+    const qint64 children = static_cast<qint64>(m_childList.size());
+    for (qint64 node = 0; node < nodes; ++node) {
+        // Parents come before their children, so following them ends
+        const qint64 parent = m_parent[node];
+        if (node > 0 && (parent < 0 || parent >= node || !(m_flags[parent] & IsDirectory))) {
+            return false;
+        }
+        if (qint64(m_nameOffset[node]) + m_nameLength[node] > names) {
+            return false;
+        }
+
+        const qint64 begin = m_childBegin[node];
+        const qint64 count = m_childCount[node];
+        if (count == 0) {
+            continue;
+        }
+        if (!(m_flags[node] & IsDirectory) || begin < 0 || count < 0 || begin + count > children) {
+            return false;
+        }
+        for (qint64 row = 0; row < count; ++row) {
+            const qint64 child = m_childList[static_cast<size_t>(begin + row)];
+            if (child <= node || child >= nodes || m_parent[child] != node || m_row[child] != row) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+QString ScanSnapshot::name(int node) const {
+    return QString::fromUtf8(m_names.constData() + m_nameOffset[node],
+                             static_cast<qsizetype>(m_nameLength[node]));
+}
+
+QString ScanSnapshot::relativePath(int node) const {
+    QStringList parts;
+    for (int current = node; current > 0; current = m_parent[current]) {
+        parts.prepend(name(current));
+    }
+    return parts.join('/');
+}
+
+QString ScanSnapshot::absolutePath(int node) const {
+    return node == 0 ? m_rootPath : m_rootPath + '/' + relativePath(node);
+}
+
+int ScanSnapshot::findDirectory(QStringView relativeDir) const {
+    if (m_parent.empty()) {
+        return -1;
+    }
+    if (relativeDir.isEmpty()) {
+        return (m_flags[0] & Listed) ? 0 : -1;
+    }
+    return m_directories.value(relativeDir.toString(), -1);
+}
+
+int ScanSnapshot::findNode(QStringView relativePath) const {
+    if (relativePath.isEmpty()) {
+        return m_parent.empty() ? -1 : 0;
+    }
+    qsizetype slash = relativePath.lastIndexOf('/');
+    int directory = findDirectory(slash == -1 ? QStringView() : relativePath.left(slash));
+    return directory < 0 ? -1 : findChild(directory, relativePath.mid(slash + 1));
+}
+
+int ScanSnapshot::findChild(int directory, QStringView name) const {
+    const QByteArray encodedName = name.toUtf8();
+    const int count = m_childCount[directory];
+    for (int row = 0; row < count; ++row) {
+        const int node = child(directory, row);
+        if (m_nameLength[node] == static_cast<quint32>(encodedName.size()) &&
+            std::memcmp(m_names.constData() + m_nameOffset[node], encodedName.constData(),
+                        static_cast<size_t>(encodedName.size())) == 0) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+std::vector<ScanEntry> ScanSnapshot::entries(int directory) const {
+    std::vector<ScanEntry> result;
+    const int count = m_childCount[directory];
+    result.reserve(count);
+
+    for (int row = 0; row < count; ++row) {
+        const int node = child(directory, row);
+        ScanEntry entry;
+        entry.name = name(node);
+        entry.isDir = isDirectory(node);
+        entry.size = m_size[node];
+        entry.mtime = m_mtime[node];
+        entry.inode = m_inode[node];
+        entry.mode = m_mode[node];
+        entry.verdict = verdict(node);
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+FileRecord ScanSnapshot::record(int node) const {
+    FileRecord record;
+    record.node = node;
+    record.size = m_size[node];
+    record.mtime = m_mtime[node];
+    record.inode = m_inode[node];
+    record.mode = m_mode[node];
+    record.verdict = verdict(node);
+    return record;
+}
+
+void ScanSnapshot::updateFile(int node, const ScanEntry& entry) {
+    m_size[node] = entry.size;
+    m_mtime[node] = entry.mtime;
+    m_inode[node] = entry.inode;
+    m_mode[node] = entry.mode;
+    m_verdict[node] = static_cast<quint8>(entry.verdict);
+}
+
+bool ScanSnapshot::applyListing(const ScanListing& listing, QVector<int>& gained, QVector<int>& lost,
+                                QStringList& droppedDirectories) {
+    const int directory = findNode(listing.relativeDir);
+    if (directory < 0 || !isDirectory(directory) || (m_flags[directory] & Removed)) {
+        return false;
+    }
+
+    // Existing children are matched by name so they keep their node ids
+    QHash<QString, int> previous;
+    const int previousCount = m_childCount[directory];
+    previous.reserve(previousCount);
+    for (int row = 0; row < previousCount; ++row) {
+        const int node = child(directory, row);
+        previous.insert(name(node), node);
+    }
+
+    std::vector<const ScanEntry*> ordered;
+    ordered.reserve(listing.entries.size());
+    for (const ScanEntry& entry : listing.entries) {
+        ordered.push_back(&entry);
+    }
+    sortChildren(ordered);
+
+    std::vector<qint32> children;
+    children.reserve(ordered.size());
+    for (const ScanEntry* entry : ordered) {
+        int node = previous.value(entry->name, -1);
+        previous.remove(entry->name);
+        if (node >= 0 && isDirectory(node) != entry->isDir) {
+            removeNode(node, lost, droppedDirectories);
+            node = -1;
+        }
+
+        if (node < 0) {
+            node = addNode(directory, *entry);
+            if (!entry->isDir && entry->verdict == FilterEngine::Verdict::Accepted) {
+                gained.append(node);
+            }
+        } else if (entry->isDir) {
+            // A directory's own mtime comes from its listing, not its parent's
+            m_verdict[node] = static_cast<quint8>(entry->verdict);
+            if (entry->verdict != FilterEngine::Verdict::Accepted) {
+                removeChildren(node, lost, droppedDirectories);
+            }
+        } else {
+            const bool wasAccepted = isAccepted(node);
+            m_size[node] = entry->size;
+            m_mtime[node] = entry->mtime;
+            m_inode[node] = entry->inode;
+            m_mode[node] = entry->mode;
+            m_verdict[node] = static_cast<quint8>(entry->verdict);
+            if (wasAccepted != isAccepted(node)) {
+                (wasAccepted ? lost : gained).append(node);
+            }
+        }
+        children.push_back(node);
+    }
+
+    for (int node : std::as_const(previous)) {
+        removeNode(node, lost, droppedDirectories);
+    }
+
+    // A list that shrank is rewritten in place, one that grew moves to the end
+    int begin = m_childBegin[directory];
+    if (static_cast<int>(children.size()) > previousCount) {
+        begin = static_cast<int>(m_childList.size());
+        m_childList.resize(m_childList.size() + children.size());
+    }
+    for (size_t row = 0; row < children.size(); ++row) {
+        m_childList[begin + row] = children[row];
+        m_row[children[row]] = static_cast<qint32>(row);
+    }
+    m_childBegin[directory] = begin;
+    m_childCount[directory] = static_cast<qint32>(children.size());
+
+    m_mtime[directory] = listing.mtime;
+    m_inode[directory] = listing.inode;
+    m_flags[directory] = static_cast<quint8>((m_flags[directory] & ~HasIgnoreFile) | Listed |
+                                             (listing.hasIgnoreFile ? HasIgnoreFile : 0));
+    m_directories.insert(listing.relativeDir, directory);
+    return true;
+}
+
+void ScanSnapshot::removeNode(int node, QVector<int>& lost, QStringList& droppedDirectories) {
+    if (isDirectory(node)) {
+        removeChildren(node, lost, droppedDirectories);
+    } else if (isAccepted(node)) {
+        lost.append(node);
+    }
+    m_flags[node] |= Removed;
+}
+
+void ScanSnapshot::removeChildren(int directory, QVector<int>& lost, QStringList& droppedDirectories) {
+    if (!(m_flags[directory] & Listed)) {
+        return;
+    }
+    const int count = m_childCount[directory];
+    for (int row = 0; row < count; ++row) {
+        removeNode(child(directory, row), lost, droppedDirectories);
+    }
+
+    const QString relativeDir = relativePath(directory);
+    m_directories.remove(relativeDir);
+    droppedDirectories.append(relativeDir);
+    m_childCount[directory] = 0;
+    m_flags[directory] &= ~Listed;
+}
+
+ScanSnapshot ScanSnapshot::compacted() const {
+    std::vector<ScanListing> listings;
+    listings.reserve(static_cast<size_t>(m_directories.size()));
+    for (auto it = m_directories.constBegin(); it != m_directories.constEnd(); ++it) {
+        const int node = it.value();
+        ScanListing listing;
+        listing.relativeDir = it.key();
+        listing.mtime = m_mtime[node];
+        listing.inode = m_inode[node];
+        listing.hasIgnoreFile = m_flags[node] & HasIgnoreFile;
+        listing.entries = entries(node);
+        listings.push_back(std::move(listing));
+    }
+    return build(m_rootPath, std::move(listings));
+}
@@ -0,0 +1,143 @@
+// ScanSnapshot.h
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+#include <vector>
+#include "FilterEngine.h"
+
+// One entry of a directory as seen by the scanner. Size, mtime and mode are
+// only known for files that got far enough through the filter to be stat'ed.
+struct ScanEntry {
+    QString name;
+    bool isDir = false;
+    qint64 size = -1;
+    qint64 mtime = 0;
+    quint64 inode = 0;
+    quint32 mode = 0;         // st_mode, 0 where the platform has none
+    FilterEngine::Verdict verdict = FilterEngine::Verdict::Accepted;
+
+    // FIFOs and devices would block or never end when read
+    bool isRegularFile() const { return mode == 0 || (mode & 0170000) == 0100000; }
+};
+
+// What the export needs to know about one file. Taken from the scan, so a
+// file is stat'ed once between the walk and the end of the export.
+struct FileRecord {
+    int node = -1;
+    qint64 size = 0;
+    qint64 mtime = 0;
+    quint64 inode = 0;
+    quint32 mode = 0;
+    FilterEngine::Verdict verdict = FilterEngine::Verdict::Accepted;
+};
+
+// Everything the scanner learned about one directory it read
+struct ScanListing {
+    QString relativeDir;      // empty for the root
+    qint64 mtime = 0;
+    quint64 inode = 0;
+    bool hasIgnoreFile = false;
+    std::vector<ScanEntry> entries;
+};
+
+// Result of a scan, stored as parallel arrays indexed by node id.
+//
+// Node 0 is the root. The children of a directory are a contiguous range of
+// m_childList, sorted directories first and then by name, so the tree can be
+// shown without touching the filesystem. Names are kept once, as UTF-8, in a
+// shared pool. The arrays are plain data, which is also how ScanIndex writes
+// them to disk.
+class ScanSnapshot {
+public:
+    enum Flag : quint8 {
+        IsDirectory   = 0x01,
+        HasIgnoreFile = 0x02,
+        Listed        = 0x04,  // directory contents were read
+        Removed       = 0x08   // left the tree during an incremental update
+    };
+
+    ScanSnapshot() = default;
+    static ScanSnapshot build(const QString& rootPath, std::vector<ScanListing> listings);
+
+    const QString& rootPath() const { return m_rootPath; }
+    int nodeCount() const { return static_cast<int>(m_parent.size()); }
+    bool isEmpty() const { return m_parent.empty(); }
+
+    int parent(int node) const { return m_parent[node]; }
+    QString name(int node) const;
+    QString relativePath(int node) const;
+    QString absolutePath(int node) const;
+    qint64 size(int node) const { return m_size[node]; }
+    qint64 mtime(int node) const { return m_mtime[node]; }
+    quint64 inode(int node) const { return m_inode[node]; }
+    quint32 mode(int node) const { return m_mode[node]; }
+    quint8 flags(int node) const { return m_flags[node]; }
+    bool isDirectory(int node) const { return m_flags[node] & IsDirectory; }
+    FilterEngine::Verdict verdict(int node) const { return static_cast<FilterEngine::Verdict>(m_verdict[node]); }
+    bool isAccepted(int node) const { return verdict(node) == FilterEngine::Verdict::Accepted; }
+    FileRecord record(int node) const;
+
+    int childCount(int node) const { return m_childCount[node]; }
+    int child(int node, int row) const { return m_childList[m_childBegin[node] + row]; }
+    int row(int node) const { return m_row[node]; }
+
+    // Node id of a directory given its path relative to the root, or -1
+    int findDirectory(QStringView relativeDir) const;
+    // Node id of any entry whose parent directory was listed, or -1
+    int findNode(QStringView relativePath) const;
+    // Entries of a listed directory, in the form the scanner produces them
+    std::vector<ScanEntry> entries(int directory) const;
+
+    // Incremental updates. Node ids stay valid: entries that are still there
+    // keep their node, new ones are appended and the ones that left the tree
+    // are flagged Removed until the snapshot is compacted.
+    // entry holds a fresh stat of the file and its new verdict
+    void updateFile(int node, const ScanEntry& entry);
+    // Replaces the entries of listing.relativeDir with a fresh listing. Files
+    // whose accepted state flipped, including those below directories that
+    // left the tree or became excluded, are appended to gained and lost;
+    // directories that are no longer listed to droppedDirectories. Listings
+    // must be applied parents first.
+    bool applyListing(const ScanListing& listing, QVector<int>& gained, QVector<int>& lost,
+                      QStringList& droppedDirectories);
+    // Copy without removed nodes, in the layout build() produces
+    ScanSnapshot compacted() const;
+
+private:
+    friend class ScanIndex;
+
+    int addNode(int parent, const ScanEntry& entry);
+    void sortChildren(std::vector<const ScanEntry*>& entries) const;
+    void indexDirectories();
+    // Whether the columns form the tree build() lays out, as a stored copy
+    // has to before anything follows its links
+    bool isWellFormed() const;
+    int findChild(int directory, QStringView name) const;
+    void removeNode(int node, QVector<int>& lost, QStringList& droppedDirectories);
+    void removeChildren(int directory, QVector<int>& lost, QStringList& droppedDirectories);
+
+    QString m_rootPath;
+
+    std::vector<qint32> m_parent;
+    std::vector<qint32> m_row;          // position among the parent's children
+    std::vector<qint32> m_childBegin;
+    std::vector<qint32> m_childCount;
+    std::vector<quint32> m_nameOffset;
+    std::vector<quint32> m_nameLength;
+    std::vector<qint64> m_size;
+    std::vector<qint64> m_mtime;
+    std::vector<quint64> m_inode;
+    std::vector<quint32> m_mode;
+    std::vector<quint8> m_flags;
+    std::vector<quint8> m_verdict;
+
+    std::vector<qint32> m_childList;
+    QByteArray m_names;
+
+    QHash<QString, int> m_directories;  // relative path -> node, listed directories only
+};
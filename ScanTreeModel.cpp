@@ -0,0 +1,366 @@
+#include "ScanTreeModel.h"
+#include <QDateTime>
+#include <QFileIconProvider>
+#include <QGuiApplication>
+#include <QLocale>
+#include <QPalette>
+#include <QSet>
+#include <algorithm>
+
+ScanTreeModel::ScanTreeModel(QObject* parent)
+    : QAbstractItemModel(parent) {
+    QFileIconProvider iconProvider;
+    m_folderIcon = iconProvider.icon(QAbstractFileIconProvider::Folder);
+    m_fileIcon = iconProvider.icon(QAbstractFileIconProvider::File);
+    m_rejectedBrush = QGuiApplication::palette().brush(QPalette::Disabled, QPalette::Text);
+}
+
+void ScanTreeModel::setSnapshot(const QSharedPointer<ScanSnapshot>& snapshot) {
+    beginResetModel();
+    m_snapshot = snapshot;
+    m_names.clear();
+    m_names.resize(snapshot ? static_cast<size_t>(snapshot->nodeCount()) : 0);
+    m_transitions.clear();
+    m_selection.reset(snapshot.data(), true);
+    endResetModel();
+    emit selectedCountChanged(m_selection.selectedCount());
+}
+
+int ScanTreeModel::childNode(int directory, int row) const {
+    auto it = m_transitions.constFind(directory);
+    return it != m_transitions.constEnd() ? it->at(row) : m_snapshot->child(directory, row);
+}
+
+int ScanTreeModel::rowOf(int node) const {
+    auto it = m_transitions.constFind(m_snapshot->parent(node));
+    if (it != m_transitions.constEnd()) {
+        auto found = std::find(it->begin(), it->end(), node);
+        return static_cast<int>(found - it->begin());
+    }
+    return m_snapshot->row(node);
+}
+
+std::vector<qint32> ScanTreeModel::children(int directory) const {
+    std::vector<qint32> result(static_cast<size_t>(m_snapshot->childCount(directory)));
+    for (size_t row = 0; row < result.size(); ++row) {
+        result[row] = m_snapshot->child(directory, static_cast<int>(row));
+    }
+    return result;
+}
+
+QModelIndex ScanTreeModel::index(int row, int column, const QModelIndex& parent) const {
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, quintptr(childNode(node(parent), row)));
+}
+
+QModelIndex ScanTreeModel::parent(const QModelIndex& child) const {
+    if (!child.isValid()) {
+        return QModelIndex();
+    }
+    return indexForNode(m_snapshot->parent(node(child)));
+}
+
+QModelIndex ScanTreeModel::indexForNode(int node, int column) const {
+    if (!m_snapshot || node <= 0) {
+        return QModelIndex();
+    }
+    return createIndex(rowOf(node), column, quintptr(node));
+}
+
+int ScanTreeModel::rowCount(const QModelIndex& parent) const {
+    if (!m_snapshot || m_snapshot->isEmpty() || parent.column() > 0) {
+        return 0;
+    }
+    const int directory = node(parent);
+    auto it = m_transitions.constFind(directory);
+    return it != m_transitions.constEnd() ? static_cast<int>(it->size()) : m_snapshot->childCount(directory);
+}
+
+int ScanTreeModel::columnCount(const QModelIndex&) const {
+    return ColumnCount;
+}
+
+const QString& ScanTreeModel::displayName(int node) const {
+    QString& name = m_names[node];
+    if (name.isNull()) {
+        name = m_snapshot->name(node);
+    }
+    return name;
+}
+
+QString ScanTreeModel::typeName(int node) const {
+    if (m_snapshot->isDirectory(node)) {
+        return QStringLiteral("Folder");
+    }
+    const QString& name = displayName(node);
+    qsizetype dot = name.lastIndexOf('.');
+    return dot > 0 ? name.mid(dot + 1) + QStringLiteral(" File") : QStringLiteral("File");
+}
+
+QVariant ScanTreeModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || !m_snapshot) {
+        return QVariant();
+    }
+    const int current = node(index);
+    const bool directory = m_snapshot->isDirectory(current);
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case NameColumn:
+            return displayName(current);
+        case SizeColumn:
+            if (directory || m_snapshot->size(current) < 0) {
+                return QVariant();
+            }
+            return QLocale().formattedDataSize(m_snapshot->size(current));
+        case TypeColumn:
+            return typeName(current);
+        case ModifiedColumn:
+            if (m_snapshot->mtime(current) <= 0) {
+                return QVariant();
+            }
+            return QLocale().toString(QDateTime::fromMSecsSinceEpoch(m_snapshot->mtime(current) / 1000000),
+                                      QLocale::ShortFormat);
+        }
+        break;
+    case Qt::CheckStateRole:
+        if (index.column() == NameColumn && m_selection.isSelectable(current)) {
+            switch (m_selection.state(current)) {
+            case FileSelection::State::All:
+                return Qt::Checked;
+            case FileSelection::State::Partial:
+                return Qt::PartiallyChecked;
+            case FileSelection::State::None:
+                return Qt::Unchecked;
+            }
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == NameColumn) {
+            return directory ? m_folderIcon : m_fileIcon;
+        }
+        break;
+    case Qt::TextAlignmentRole:
+        if (index.column() == SizeColumn) {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        break;
+    case Qt::ForegroundRole:
+        if (!m_snapshot->isAccepted(current)) {
+            return m_rejectedBrush;
+        }
+        break;
+    case Qt::ToolTipRole:
+        if (!m_snapshot->isAccepted(current)) {
+            return FilterEngine::verdictDescription(m_snapshot->verdict(current));
+        }
+        break;
+    }
+    return QVariant();
+}
+
+bool ScanTreeModel::setData(const QModelIndex& index, const QVariant& value, int role) {
+    if (role != Qt::CheckStateRole || !index.isValid() || index.column() != NameColumn) {
+        return false;
+    }
+    setSelected(node(index), value.toInt() != Qt::Unchecked);
+    return true;
+}
+
+void ScanTreeModel::setSelected(int node, bool selected) {
+    if (node < 0 || !m_selection.isSelectable(node)) {
+        return;
+    }
+    m_selection.setSelected(node, selected);
+
+    // Rows of collapsed descendants are painted from the selection when shown
+    const QModelIndex changed = indexForNode(node);
+    if (changed.isValid()) {
+        emit dataChanged(changed, changed, {Qt::CheckStateRole});
+    }
+    const int children = rowCount(changed);
+    if (children > 0) {
+        emit dataChanged(index(0, NameColumn, changed), index(children - 1, NameColumn, changed),
+                         {Qt::CheckStateRole});
+    }
+    emitAncestorsChanged(node);
+    emit selectedCountChanged(m_selection.selectedCount());
+}
+
+void ScanTreeModel::emitAncestorsChanged(int node) {
+    for (int current = m_snapshot->parent(node); current > 0; current = m_snapshot->parent(current)) {
+        const QModelIndex changed = indexForNode(current);
+        emit dataChanged(changed, changed, {Qt::CheckStateRole});
+    }
+}
+
+QVariant ScanTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case NameColumn:
+        return QStringLiteral("Name");
+    case SizeColumn:
+        return QStringLiteral("Size");
+    case TypeColumn:
+        return QStringLiteral("Type");
+    case ModifiedColumn:
+        return QStringLiteral("Date Modified");
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags ScanTreeModel::flags(const QModelIndex& index) const {
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    Qt::ItemFlags itemFlags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    if (index.column() == NameColumn && m_selection.isSelectable(node(index))) {
+        itemFlags |= Qt::ItemIsUserCheckable;
+    }
+    if (!isDir(index)) {
+        itemFlags |= Qt::ItemNeverHasChildren;
+    }
+    return itemFlags;
+}
+
+QModelIndex ScanTreeModel::index(const QString& filePath, int column) const {
+    if (!m_snapshot) {
+        return QModelIndex();
+    }
+    const QString& root = m_snapshot->rootPath();
+    if (filePath.size() <= root.size() || !filePath.startsWith(root) || filePath[root.size()] != '/') {
+        return QModelIndex();
+    }
+    int found = m_snapshot->findNode(QStringView(filePath).mid(root.size() + 1));
+    if (found < 0 || (m_snapshot->flags(found) & ScanSnapshot::Removed)) {
+        return QModelIndex();
+    }
+    return indexForNode(found, column);
+}
+
+QString ScanTreeModel::filePath(const QModelIndex& index) const {
+    return m_snapshot ? m_snapshot->absolutePath(node(index)) : QString();
+}
+
+bool ScanTreeModel::isDir(const QModelIndex& index) const {
+    return m_snapshot && m_snapshot->isDirectory(node(index));
+}
+
+bool ScanTreeModel::applyListing(const ScanListing& listing, QVector<int>& gained, QVector<int>& lost,
+                                 QStringList& droppedDirectories) {
+    const int directory = m_snapshot ? m_snapshot->findNode(listing.relativeDir) : -1;
+    if (directory < 0) {
+        return false;
+    }
+
+    // Rows as the views know them, also for subdirectories that may lose theirs
+    const std::vector<qint32> before = children(directory);
+    QHash<int, std::vector<qint32>> subdirectories;
+    for (int child : before) {
+        if (m_snapshot->isDirectory(child) && m_snapshot->childCount(child) > 0) {
+            subdirectories.insert(child, children(child));
+        }
+    }
+
+    const qsizetype firstGained = gained.size();
+    const qsizetype firstLost = lost.size();
+    if (!m_snapshot->applyListing(listing, gained, lost, droppedDirectories)) {
+        return false;
+    }
+    m_names.resize(static_cast<size_t>(m_snapshot->nodeCount()));
+    for (qsizetype i = firstLost; i < lost.size(); ++i) {
+        m_selection.removeFile(lost[i]);
+    }
+    for (qsizetype i = firstGained; i < gained.size(); ++i) {
+        m_selection.addFile(gained[i], true);
+    }
+
+    // The snapshot changed in one step; replay it as removals and insertions
+    // while rowCount() and index() still serve the rows being changed
+    const std::vector<qint32> after = children(directory);
+    const QModelIndex parentIndex = indexForNode(directory);
+    m_transitions.insert(directory, before);
+
+    // Subdirectories that became excluded and lost their children
+    for (auto it = subdirectories.constBegin(); it != subdirectories.constEnd(); ++it) {
+        const int child = it.key();
+        if ((m_snapshot->flags(child) & ScanSnapshot::Removed) || m_snapshot->childCount(child) > 0) {
+            continue;
+        }
+        m_transitions.insert(child, it.value());
+        beginRemoveRows(indexForNode(child), 0, static_cast<int>(it.value().size()) - 1);
+        m_transitions[child].clear();
+        endRemoveRows();
+        m_transitions.remove(child);
+    }
+
+    // Entries that are kept stay in the same relative order, so removing the
+    // vanished ones and inserting the new ones yields the final rows
+    const QSet<qint32> kept(after.begin(), after.end());
+    const QSet<qint32> existing(before.begin(), before.end());
+    std::vector<qint32>& rows = m_transitions[directory];
+    for (int last = static_cast<int>(rows.size()) - 1; last >= 0;) {
+        if (kept.contains(rows[last])) {
+            --last;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && !kept.contains(rows[first - 1])) {
+            --first;
+        }
+        beginRemoveRows(parentIndex, first, last);
+        rows.erase(rows.begin() + first, rows.begin() + last + 1);
+        endRemoveRows();
+        last = first - 1;
+    }
+    for (int first = 0; first < static_cast<int>(after.size());) {
+        if (existing.contains(after[first])) {
+            ++first;
+            continue;
+        }
+        int last = first;
+        while (last + 1 < static_cast<int>(after.size()) && !existing.contains(after[last + 1])) {
+            ++last;
+        }
+        beginInsertRows(parentIndex, first, last);
+        rows.insert(rows.begin() + first, after.begin() + first, after.begin() + last + 1);
+        endInsertRows();
+        first = last + 1;
+    }
+    m_transitions.remove(directory);
+
+    // Sizes, verdicts and check states of the kept entries may have changed
+    if (!after.empty()) {
+        emit dataChanged(index(0, 0, parentIndex),
+                         index(static_cast<int>(after.size()) - 1, ColumnCount - 1, parentIndex));
+    }
+    if (lost.size() > firstLost || gained.size() > firstGained) {
+        if (parentIndex.isValid()) {
+            emit dataChanged(parentIndex, parentIndex, {Qt::CheckStateRole});
+        }
+        emitAncestorsChanged(directory);
+        emit selectedCountChanged(m_selection.selectedCount());
+    }
+    return true;
+}
+
+void ScanTreeModel::updateFile(int node, const ScanEntry& entry) {
+    const bool wasAccepted = m_snapshot->isAccepted(node);
+    m_snapshot->updateFile(node, entry);
+    emit dataChanged(indexForNode(node, 0), indexForNode(node, ColumnCount - 1));
+
+    if (wasAccepted != m_snapshot->isAccepted(node)) {
+        if (wasAccepted) {
+            m_selection.removeFile(node);
+        } else {
+            m_selection.addFile(node, true);
+        }
+        emitAncestorsChanged(node);
+        emit selectedCountChanged(m_selection.selectedCount());
+    }
+}
@@ -0,0 +1,92 @@
+// ScanTreeModel.h
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QBrush>
+#include <QHash>
+#include <QIcon>
+#include <QSharedPointer>
+#include <QStringList>
+#include <vector>
+#include "FileSelection.h"
+#include "ScanSnapshot.h"
+
+// Tree model over a ScanSnapshot.
+//
+// Every index carries its snapshot node id, so index(), parent() and
+// rowCount() are array lookups and painting never touches the filesystem:
+// names, sizes, dates and verdicts all come from the snapshot. The view only
+// creates items for directories it expands, so opening a huge tree costs no
+// more than its first level. Entries the filter rejects are greyed out, with
+// the reason as tooltip.
+//
+// Accepted files and the directories above them carry a (tri-state) check
+// box backed by a FileSelection; a new snapshot starts with everything
+// accepted checked.
+class ScanTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+
+public:
+    enum Column {
+        NameColumn,
+        SizeColumn,
+        TypeColumn,
+        ModifiedColumn,
+        ColumnCount
+    };
+
+    explicit ScanTreeModel(QObject* parent = nullptr);
+
+    // Shows a new snapshot; the previous rows are dropped
+    void setSnapshot(const QSharedPointer<ScanSnapshot>& snapshot);
+    QSharedPointer<ScanSnapshot> snapshot() const { return m_snapshot; }
+    const FileSelection& selection() const { return m_selection; }
+    void setSelected(int node, bool selected);
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    // The root node is the invalid index, as for a view's root index
+    int node(const QModelIndex& index) const { return index.isValid() ? static_cast<int>(index.internalId()) : 0; }
+    QModelIndex indexForNode(int node, int column = 0) const;
+    QModelIndex index(const QString& filePath, int column = 0) const;
+    QString filePath(const QModelIndex& index) const;
+    bool isDir(const QModelIndex& index) const;
+
+    // Incremental updates: forwarded to the snapshot, with the row signals
+    // views need to keep their expanded rows. Files that become accepted
+    // are checked, files that stop being accepted are unchecked.
+    bool applyListing(const ScanListing& listing, QVector<int>& gained, QVector<int>& lost,
+                      QStringList& droppedDirectories);
+    void updateFile(int node, const ScanEntry& entry);
+
+signals:
+    void selectedCountChanged(int selectedFiles);
+
+private:
+    int childNode(int directory, int row) const;
+    int rowOf(int node) const;
+    std::vector<qint32> children(int directory) const;
+    const QString& displayName(int node) const;
+    QString typeName(int node) const;
+    // Check states of node's ancestors depend on it
+    void emitAncestorsChanged(int node);
+
+    QSharedPointer<ScanSnapshot> m_snapshot;
+    // Names are decoded once, when first painted
+    mutable std::vector<QString> m_names;
+    FileSelection m_selection;
+
+    // While an update is being replayed, the rows views still know about
+    QHash<int, std::vector<qint32>> m_transitions;
+
+    QIcon m_folderIcon;
+    QIcon m_fileIcon;
+    QBrush m_rejectedBrush;
+};
@@ -0,0 +1,182 @@
+#include "ShardWriter.h"
+#include "BlockCompressor.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <cstdio>
+
+namespace {
+// How far the export may run ahead of the disk, per output file
+constexpr qint64 kMaxQueuedBytes = 16 * 1024 * 1024;
+}
+
+ShardWriter::ShardWriter(const QString& path, const ExportControl* control)
+    : m_path(path)
+    , m_control(control)
+    , m_output(isStandardOutput(path) ? std::unique_ptr<QFileDevice>(std::make_unique<QFile>())
+                                      : std::make_unique<QSaveFile>(path)) {
+}
+
+ShardWriter::~ShardWriter() {
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopping = true;
+            m_changed.wakeAll();
+        }
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+QString ShardWriter::errorString() const {
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+bool ShardWriter::open() {
+    // Text mode applies to what goes into the compressor, whose output is
+    // binary
+    const BlockCompressor::Format format = BlockCompressor::formatForPath(m_path);
+    const bool toStandardOutput = isStandardOutput(m_path);
+    auto openOutput = [&](QIODevice::OpenMode mode) {
+        // stdout does its own line ending translation, where there is any
+        if (toStandardOutput) {
+            return static_cast<QFile*>(m_output.get())->open(stdout, mode & ~QIODevice::Text,
+                                                             QFileDevice::DontCloseHandle);
+        }
+        return m_output->open(mode);
+    };
+    bool opened;
+    if (format == BlockCompressor::Format::None) {
+        opened = openOutput(QIODevice::WriteOnly | QIODevice::Text);
+        m_sink = m_output.get();
+    } else {
+        m_compressor = std::make_unique<BlockCompressor>(format, m_output.get());
+        opened = openOutput(QIODevice::WriteOnly) &&
+                 m_compressor->open(QIODevice::WriteOnly | QIODevice::Text);
+        m_sink = m_compressor.get();
+    }
+    // Whatever reads standard output wants the text alone
+    if (!opened || (!toStandardOutput && m_sink->write("\xEF\xBB\xBF") != 3)) {
+        m_errorString = m_sink->errorString();
+        return false;
+    }
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start();
+    return true;
+}
+
+bool ShardWriter::write(const QByteArray& bytes) {
+    Piece piece;
+    piece.bytes = bytes;
+    piece.size = bytes.size();
+    return enqueue(std::move(piece));
+}
+
+bool ShardWriter::write(OpenedFile file) {
+    Piece piece;
+    piece.size = file.size();
+    piece.file = std::move(file);
+    return enqueue(std::move(piece));
+}
+
+bool ShardWriter::enqueue(Piece piece) {
+    QMutexLocker locker(&m_mutex);
+    // Always lets one piece through, however large
+    while (!m_failed && !m_queue.empty() && m_queuedBytes + piece.size > kMaxQueuedBytes) {
+        m_changed.wait(&m_mutex);
+    }
+    if (m_failed) {
+        return false;
+    }
+    m_queuedBytes += piece.size;
+    m_queue.push_back(std::move(piece));
+    m_changed.wakeAll();
+    return true;
+}
+
+void ShardWriter::close() {
+    QMutexLocker locker(&m_mutex);
+    m_closing = true;
+    m_changed.wakeAll();
+}
+
+bool ShardWriter::finish() {
+    close();
+    if (m_thread) {
+        m_thread->wait();
+    }
+    QMutexLocker locker(&m_mutex);
+    return !m_failed;
+}
+
+bool ShardWriter::commit() {
+    if (isStandardOutput(m_path)) {
+        if (!m_output->flush()) {
+            m_errorString = m_output->errorString();
+            return false;
+        }
+        return true;
+    }
+    auto* output = static_cast<QSaveFile*>(m_output.get());
+    if (!output->commit()) {
+        m_errorString = output->errorString();
+        return false;
+    }
+    QFile::setPermissions(m_path, QFile::ReadOwner | QFile::WriteOwner |
+                                  QFile::ReadUser | QFile::WriteUser |
+                                  QFile::ReadGroup | QFile::ReadOther);
+    return true;
+}
+
+void ShardWriter::fail(const QString& errorString) {
+    QMutexLocker locker(&m_mutex);
+    m_failed = true;
+    m_errorString = errorString;
+    m_changed.wakeAll();
+}
+
+void ShardWriter::run() {
+    for (;;) {
+        Piece piece;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.empty() && !m_closing && !m_stopping) {
+                m_changed.wait(&m_mutex);
+            }
+            if (m_stopping || m_queue.empty()) {
+                break;
+            }
+            piece = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_queuedBytes -= piece.size;
+            m_changed.wakeAll();
+        }
+
+        // An empty error from copyTo() means the export was cancelled
+        QString errorString;
+        bool written;
+        if (piece.file.isOpen()) {
+            written = piece.file.copyTo(*m_output, errorString, m_control);
+        } else {
+            written = m_sink->write(piece.bytes) == piece.bytes.size();
+            errorString = m_sink->errorString();
+        }
+        if (!written) {
+            fail(errorString);
+            return;
+        }
+    }
+
+    // The compressor still holds the last block
+    bool stopping;
+    {
+        QMutexLocker locker(&m_mutex);
+        stopping = m_stopping;
+    }
+    if (!stopping && m_compressor && !m_compressor->finish()) {
+        fail(m_compressor->errorString());
+    }
+}
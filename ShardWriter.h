@@ -0,0 +1,84 @@
+// ShardWriter.h
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <deque>
+#include <memory>
+#include "FileReader.h"
+
+class BlockCompressor;
+class ExportControl;
+class QFileDevice;
+class QIODevice;
+class QThread;
+
+// One output file of a saved export, written by a thread of its own.
+//
+// The export queues pieces in output order and moves on while the thread
+// writes them, through a BlockCompressor for .gz and .zst names. When an
+// export is split into shards, the next shard is filled while the previous
+// one is still being written. Nothing replaces the destination before
+// commit(), so a failed or cancelled export leaves it as it was.
+//
+// The path "-" writes to standard output instead, as it goes: without a
+// BOM, and with files copied through user space, since a pipe can't take
+// them from the kernel.
+class ShardWriter {
+public:
+    static bool isStandardOutput(const QString& path) { return path == QLatin1String("-"); }
+
+    ShardWriter(const QString& path, const ExportControl* control);
+    ~ShardWriter();
+
+    ShardWriter(const ShardWriter&) = delete;
+    ShardWriter& operator=(const ShardWriter&) = delete;
+
+    const QString& path() const { return m_path; }
+    QString errorString() const;
+    // Whether files may be handed over open, for the kernel to copy
+    bool copiesFiles() const { return !m_compressor && !isStandardOutput(m_path); }
+
+    // Opens a temporary file next to path, writes the BOM and starts the
+    // thread; standard output is opened as it is
+    bool open();
+    // False once writing has failed. Blocks while a lot is queued.
+    bool write(const QByteArray& bytes);
+    bool write(OpenedFile file);
+    // No more pieces; the thread ends once it has written the queue
+    void close();
+    // Closes and waits for the thread; false if anything failed
+    bool finish();
+    // Replaces path with what was written; only after finish(). Standard
+    // output is just flushed.
+    bool commit();
+
+private:
+    struct Piece {
+        QByteArray bytes;
+        OpenedFile file;
+        qint64 size = 0;
+    };
+
+    bool enqueue(Piece piece);
+    void run();
+    void fail(const QString& errorString);
+
+    const QString m_path;
+    const ExportControl* m_control;
+    std::unique_ptr<QFileDevice> m_output;
+    std::unique_ptr<BlockCompressor> m_compressor;
+    QIODevice* m_sink = nullptr;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_changed;
+    std::deque<Piece> m_queue;
+    qint64 m_queuedBytes = 0;
+    bool m_closing = false;
+    bool m_stopping = false;    // being destroyed: the queue is dropped
+    bool m_failed = false;
+    QString m_errorString;
+    QThread* m_thread = nullptr;
+};
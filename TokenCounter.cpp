@@ -0,0 +1,107 @@
+#include "TokenCounter.h"
+#include <array>
+
+namespace {
+
+enum ByteClass : unsigned char {
+    Letter,         // ASCII letters, '_' and every byte of a non-ASCII character
+    Digit,
+    Space,
+    Punctuation     // everything else, control characters included
+};
+
+constexpr std::array<unsigned char, 256> makeClassTable() {
+    std::array<unsigned char, 256> table = {};
+    for (int c = 0; c < 256; ++c) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80) {
+            table[c] = Letter;
+        } else if (c >= '0' && c <= '9') {
+            table[c] = Digit;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') {
+            table[c] = Space;
+        } else {
+            table[c] = Punctuation;
+        }
+    }
+    return table;
+}
+constexpr std::array<unsigned char, 256> kClass = makeClassTable();
+
+// Letters BPE merges into one token, about
+constexpr qsizetype kLettersPerToken = 8;
+// Digits are split into groups of three, punctuation merges about as far
+constexpr qsizetype kDigitsPerToken = 3;
+constexpr qsizetype kPunctuationPerToken = 3;
+// Indentation runs are single tokens up to about this long
+constexpr qsizetype kSpacesPerToken = 16;
+
+inline qint64 tokensFor(qsizetype length, qsizetype perToken) {
+    return (length + perToken - 1) / perToken;
+}
+
+inline bool isLower(unsigned char c) {
+    return c >= 'a' && c <= 'z';
+}
+
+inline bool isUpper(unsigned char c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+} // namespace
+
+qint64 TokenCounter::count(const char* data, qsizetype size) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    qint64 tokens = 0;
+    qsizetype i = 0;
+    while (i < size) {
+        const qsizetype start = i;
+        switch (kClass[bytes[i]]) {
+        case Letter: {
+            // ASCII letters since the last word part boundary
+            qsizetype part = 0;
+            do {
+                const unsigned char c = bytes[i];
+                if (c >= 0x80) {
+                    tokens += tokensFor(part, kLettersPerToken);
+                    part = 0;
+                    tokens += c >= 0xC0;    // lead bytes: one per character
+                } else {
+                    const bool boundary = c == '_' || (isUpper(c) && i > start && isLower(bytes[i - 1]));
+                    if (boundary) {
+                        tokens += tokensFor(part, kLettersPerToken);
+                        part = 0;
+                    }
+                    ++part;
+                }
+                ++i;
+            } while (i < size && kClass[bytes[i]] == Letter);
+            tokens += tokensFor(part, kLettersPerToken);
+            break;
+        }
+        case Digit:
+            do {
+                ++i;
+            } while (i < size && kClass[bytes[i]] == Digit);
+            tokens += tokensFor(i - start, kDigitsPerToken);
+            break;
+        case Space: {
+            do {
+                ++i;
+            } while (i < size && kClass[bytes[i]] == Space);
+            // A single space in front of a word or symbol belongs to it
+            const bool leading = i - start == 1 && bytes[start] == ' ' && i < size;
+            if (!leading) {
+                tokens += tokensFor(i - start, kSpacesPerToken);
+            }
+            break;
+        }
+        default:
+            do {
+                ++i;
+            } while (i < size && kClass[bytes[i]] == Punctuation);
+            tokens += tokensFor(i - start, kPunctuationPerToken);
+            break;
+        }
+    }
+    return tokens;
+}
@@ -0,0 +1,23 @@
+// TokenCounter.h
+#pragma once
+
+#include <QByteArray>
+
+// Estimates how many tokens a BPE tokenizer of the cl100k kind makes of
+// UTF-8 text, without loading a vocabulary.
+//
+// Text is split the way such tokenizers split it before merging: letter
+// runs (taking one leading space), digits in groups of three, punctuation
+// runs and whitespace runs. Letter runs are then charged one token per
+// camelCase or snake_case part of up to eight letters, and one per
+// non-ASCII character. One table lookup per byte, so it runs at several
+// hundred MB/s. It is an estimate: close for English and source code, on
+// the high side for CJK text.
+class TokenCounter {
+public:
+    static qint64 count(const char* data, qsizetype size);
+    static qint64 count(const QByteArray& text) { return count(text.constData(), text.size()); }
+
+    // For files nothing has counted yet
+    static qint64 estimateFromSize(qint64 bytes) { return (qMax<qint64>(bytes, 0) + 3) / 4; }
+};
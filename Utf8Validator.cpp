@@ -0,0 +1,122 @@
+#include "Utf8Validator.h"
+#include <cstring>
+
+namespace {
+
+constexpr quint64 kHighBits = 0x8080808080808080ULL;
+
+// Length of the valid sequence at p, or 0. For an invalid one, invalidLength
+// is how many bytes to replace: the lead byte and whatever continuation
+// bytes it accepted before the sequence broke off.
+qsizetype sequenceLength(const unsigned char* p, qsizetype remaining, qsizetype& invalidLength) {
+    const unsigned char lead = p[0];
+    if (lead < 0x80) {
+        return 1;
+    }
+
+    // The second byte's range rules out overlong forms, surrogates and
+    // code points past U+10FFFF
+    qsizetype length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) {
+            low = 0xA0;
+        } else if (lead == 0xED) {
+            high = 0x9F;
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) {
+            low = 0x90;
+        } else if (lead == 0xF4) {
+            high = 0x8F;
+        }
+    } else {
+        invalidLength = 1;
+        return 0;
+    }
+
+    qsizetype i = 1;
+    for (; i < length && i < remaining; ++i) {
+        if (p[i] < low || p[i] > high) {
+            break;
+        }
+        low = 0x80;
+        high = 0xBF;
+    }
+    if (i == length) {
+        return length;
+    }
+    invalidLength = i;
+    return 0;
+}
+
+} // namespace
+
+qsizetype Utf8Validator::firstInvalid(const char* data, qsizetype size) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    qsizetype i = 0;
+    while (i < size) {
+        // Two words per step; the compiler turns this into vector loads
+        while (i + 16 <= size) {
+            quint64 words[2];
+            std::memcpy(words, bytes + i, sizeof(words));
+            if ((words[0] | words[1]) & kHighBits) {
+                break;
+            }
+            i += 16;
+        }
+        while (i < size && bytes[i] < 0x80) {
+            ++i;
+        }
+        if (i == size) {
+            break;
+        }
+
+        qsizetype invalidLength;
+        const qsizetype length = sequenceLength(bytes + i, size - i, invalidLength);
+        if (length == 0) {
+            return i;
+        }
+        i += length;
+    }
+    return -1;
+}
+
+QByteArray Utf8Validator::repaired(const QByteArray& bytes, qsizetype from, int* replacements) {
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.constData());
+    const qsizetype size = bytes.size();
+    QByteArray result;
+    result.reserve(size + 16);
+
+    int replaced = 0;
+    qsizetype copied = 0;
+    qsizetype i = qMax<qsizetype>(from, 0);
+    while (i < size) {
+        if (data[i] < 0x80) {
+            ++i;
+            continue;
+        }
+        qsizetype invalidLength;
+        const qsizetype length = sequenceLength(data + i, size - i, invalidLength);
+        if (length > 0) {
+            i += length;
+            continue;
+        }
+        result.append(bytes.constData() + copied, i - copied);
+        result.append("\xEF\xBF\xBD", 3);
+        ++replaced;
+        i += invalidLength;
+        copied = i;
+    }
+    result.append(bytes.constData() + copied, size - copied);
+
+    if (replacements) {
+        *replacements = replaced;
+    }
+    return result;
+}
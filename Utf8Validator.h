@@ -0,0 +1,27 @@
+// Utf8Validator.h
+#pragma once
+
+#include <QByteArray>
+
+// Checks and repairs UTF-8 without decoding it.
+//
+// ASCII, which is most of any source tree, is checked sixteen bytes at a
+// time; only multi-byte sequences go through the byte-wise checks. Overlong
+// forms, surrogates and code points past U+10FFFF count as invalid.
+class Utf8Validator {
+public:
+    // Offset of the first byte that doesn't start or continue a valid
+    // sequence, or -1 when the whole buffer is valid
+    static qsizetype firstInvalid(const char* data, qsizetype size);
+    static qsizetype firstInvalid(const QByteArray& bytes) {
+        return firstInvalid(bytes.constData(), bytes.size());
+    }
+
+    static bool isValid(const char* data, qsizetype size) { return firstInvalid(data, size) < 0; }
+    static bool isValid(const QByteArray& bytes) { return firstInvalid(bytes) < 0; }
+
+    // bytes with each invalid sequence replaced by U+FFFD, starting the
+    // search at from (bytes before it are known to be valid). replacements,
+    // when given, receives how many were made.
+    static QByteArray repaired(const QByteArray& bytes, qsizetype from = 0, int* replacements = nullptr);
+};
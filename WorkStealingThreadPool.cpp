@@ -0,0 +1,128 @@
+#include "WorkStealingThreadPool.h"
+#include <QThread>
+#include <algorithm>
+
+namespace {
+// Which pool and worker the current thread belongs to, if any
+thread_local const WorkStealingThreadPool* currentPool = nullptr;
+thread_local int currentWorker = -1;
+}
+
+WorkStealingThreadPool::WorkStealingThreadPool(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1, QThread::idealThreadCount());
+    }
+
+    m_queues.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    m_threads.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        QThread* thread = QThread::create([this, i]() { workerLoop(i); });
+        thread->start();
+        m_threads.push_back(thread);
+    }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+    waitForDone();
+
+    {
+        QMutexLocker locker(&m_idleMutex);
+        m_stopping = true;
+        m_workAvailable.wakeAll();
+    }
+    for (QThread* thread : m_threads) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+void WorkStealingThreadPool::submit(Task task) {
+    WorkerQueue& queue = currentPool == this ? *m_queues[currentWorker] : m_submitted;
+
+    ++m_pending;
+    {
+        QMutexLocker locker(&queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    ++m_queued;
+
+    // Taking the idle mutex orders this wake-up after any worker's check of
+    // m_queued, so a worker about to sleep cannot miss it
+    QMutexLocker locker(&m_idleMutex);
+    m_workAvailable.wakeOne();
+}
+
+void WorkStealingThreadPool::waitForDone() {
+    QMutexLocker locker(&m_idleMutex);
+    while (m_pending.load() > 0) {
+        m_allDone.wait(&m_idleMutex);
+    }
+}
+
+bool WorkStealingThreadPool::takeTask(int index, Task& task) {
+    // Own deque first, newest task first
+    {
+        WorkerQueue& own = *m_queues[index];
+        QMutexLocker locker(&own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Then what was submitted from outside, in order
+    {
+        QMutexLocker locker(&m_submitted.mutex);
+        if (!m_submitted.tasks.empty()) {
+            task = std::move(m_submitted.tasks.front());
+            m_submitted.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // Then steal the oldest task of someone else
+    const int count = static_cast<int>(m_queues.size());
+    for (int offset = 1; offset < count; ++offset) {
+        WorkerQueue& victim = *m_queues[(index + offset) % count];
+        QMutexLocker locker(&victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingThreadPool::workerLoop(int index) {
+    currentPool = this;
+    currentWorker = index;
+
+    Task task;
+    for (;;) {
+        if (takeTask(index, task)) {
+            --m_queued;
+            task();
+            task = nullptr;
+
+            if (--m_pending == 0) {
+                QMutexLocker locker(&m_idleMutex);
+                m_allDone.wakeAll();
+            }
+            continue;
+        }
+
+        QMutexLocker locker(&m_idleMutex);
+        while (m_queued.load() == 0 && !m_stopping) {
+            m_workAvailable.wait(&m_idleMutex);
+        }
+        if (m_stopping && m_queued.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+// WorkStealingThreadPool.h
+#pragma once
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QThread;
+
+// Fixed-size thread pool where every worker owns a task deque.
+//
+// Tasks submitted from inside a worker go to that worker's own deque and are
+// taken newest-first, which keeps recursive work (one task per directory,
+// one task per file range) depth-first and cache friendly. Tasks submitted
+// from outside the pool go to one shared queue and start in the order they
+// were submitted, so a caller consuming results in that order (the export's
+// ordered read-ahead) gets the one it waits for first. Workers take from
+// their own deque, then from the shared queue, then steal the oldest task
+// from another worker's deque.
+class WorkStealingThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingThreadPool(int threadCount = 0);  // 0 = ideal thread count
+    ~WorkStealingThreadPool();
+
+    WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+    WorkStealingThreadPool& operator=(const WorkStealingThreadPool&) = delete;
+
+    void submit(Task task);
+    // Blocks until every submitted task, including tasks submitted by other
+    // tasks, has finished
+    void waitForDone();
+
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    struct WorkerQueue {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(int index);
+    bool takeTask(int index, Task& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    WorkerQueue m_submitted;         // from outside the pool, oldest first
+    std::vector<QThread*> m_threads;
+
+    QMutex m_idleMutex;
+    QWaitCondition m_workAvailable;
+    QWaitCondition m_allDone;
+
+    std::atomic<int> m_queued{0};    // tasks sitting in a deque
+    std::atomic<int> m_pending{0};   // tasks submitted but not finished
+    std::atomic<bool> m_stopping{false};
+};
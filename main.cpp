@@ -2,6 +2,7 @@
 // Application entry point with enhanced initialization and error handling
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QMessageBox>
 #include <QDir>
 #include <QLoggingCategory>
@@ -10,6 +11,7 @@
 #include <QFile>
 #include <QTextStream>
 
+#include "HeadlessExport.h"
 #include "MainWindow.h"
 
 // Custom message handler for logging
@@ -74,6 +76,17 @@ void customMessageHandler(QtMsgType type, const QMessageLogContext &context, con
 
 int main(int argc, char *argv[]) 
 {
+    // Command-line exports skip widgets, the log file and message boxes
+    // altogether, so output starts before a window could have
+    if (HeadlessExport::requested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        app.setApplicationName("Codebase Processor");
+        app.setApplicationVersion("1.0.0");
+        app.setOrganizationName("Codebase Tools");
+        app.setOrganizationDomain("kgromero.com");
+        return HeadlessExport::run(app);
+    }
+
     // Install custom message handler before creating QApplication
     qInstallMessageHandler(customMessageHandler);
 